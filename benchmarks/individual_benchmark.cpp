@@ -0,0 +1,148 @@
+// Compares the virtual IndividualPrototype with the CRTP StaticIndividualPrototype,
+// on the individual of the evolution test (bit string genome).
+
+#include <speciation/Individual.h>
+#include <speciation/Genus.h>
+#include <speciation/Selection.h>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+template<template<typename, typename> class Prototype>
+class BitIndividual : public Prototype<float, BitIndividual<Prototype> > {
+    std::vector<bool> genome;
+    std::optional<float> _fitness;
+
+public:
+    template<typename RandomGenerator>
+    BitIndividual(size_t size, RandomGenerator &g)
+            : genome(size, false)
+    {
+        std::bernoulli_distribution d(0.5);
+        for (size_t i = 0; i < genome.size(); i++) {
+            genome[i] = d(g);
+        }
+        evaluate();
+    }
+
+    BitIndividual(const BitIndividual &other) = default;
+
+    float evaluate()
+    {
+        _fitness = 0;
+        for (auto &&value : genome) {
+            if (value) (*_fitness) += 1;
+        }
+        return _fitness.value();
+    }
+
+    [[nodiscard]] std::optional<float> fitness() const
+    {
+        return _fitness;
+    }
+
+    [[nodiscard]] bool is_compatible(const BitIndividual &other) const
+    {
+        unsigned int distance = 0;
+        for (size_t i = 0; i < genome.size(); i++) {
+            if (genome[i] != other.genome[i])
+                distance++;
+        }
+        return distance > (genome.size() / 3);
+    }
+
+    [[nodiscard]] BitIndividual clone() const
+    {
+        return BitIndividual(*this);
+    }
+};
+
+using VirtualIndividual = BitIndividual<speciation::IndividualPrototype>;
+using StaticIndividual = BitIndividual<speciation::StaticIndividualPrototype>;
+
+static_assert(speciation::is_individual_v<VirtualIndividual, float>);
+static_assert(speciation::is_individual_v<StaticIndividual, float>);
+
+volatile double sink = 0;
+
+double milliseconds(const std::function<void()> &run)
+{
+    auto start = std::chrono::steady_clock::now();
+    run();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+template<typename I>
+std::vector<std::unique_ptr<I> > population(size_t size, size_t genome_size)
+{
+    std::mt19937 g(42);
+    std::vector<std::unique_ptr<I> > individuals;
+    for (size_t i = 0; i < size; i++) {
+        individuals.emplace_back(std::make_unique<I>(genome_size, g));
+    }
+    return individuals;
+}
+
+template<typename I>
+double best_individual()
+{
+    auto individuals = population<I>(100000, 16);
+    speciation::Species<I, float> species(individuals.begin(), individuals.end(), 1);
+    return milliseconds([&species]() {
+        for (int i = 0; i < 100; i++) {
+            sink = sink + species.get_best_individual()->individual->fitness().value();
+        }
+    });
+}
+
+template<typename I>
+double tournament()
+{
+    auto individuals = population<I>(10000, 16);
+    speciation::Species<I, float> species(individuals.begin(), individuals.end(), 1);
+    speciation::Conf conf;
+    species.compute_adjust_fitness(true, conf);
+    std::mt19937 g(0);
+    return milliseconds([&]() {
+        for (int i = 0; i < 1000000; i++) {
+            auto selected = speciation::tournament_selection<float>(species.cbegin(), species.cend(), g, 4);
+            sink = sink + selected->individual->fitness().value();
+        }
+    });
+}
+
+template<typename I>
+double speciate()
+{
+    return milliseconds([]() {
+        for (int i = 0; i < 20; i++) {
+            auto individuals = population<I>(5000, 64);
+            speciation::Genus<I, float> genus;
+            genus.speciate(individuals.begin(), individuals.end());
+            sink = sink + static_cast<double>(genus.size());
+        }
+    });
+}
+
+void report(const char *name, double virtual_ms, double static_ms)
+{
+    std::printf("%-18s %12.2f %12.2f %9.2fx\n", name, virtual_ms, static_ms, virtual_ms / static_ms);
+}
+
+}
+
+int main()
+{
+    std::printf("%-18s %12s %12s %10s\n", "benchmark", "virtual ms", "static ms", "speedup");
+    report("best individual", best_individual<VirtualIndividual>(), best_individual<StaticIndividual>());
+    report("tournament", tournament<VirtualIndividual>(), tournament<StaticIndividual>());
+    report("speciate", speciate<VirtualIndividual>(), speciate<StaticIndividual>());
+    return 0;
+}
@@ -0,0 +1,409 @@
+#ifndef SPECIATION_ASYNCEVALUATION_H
+#define SPECIATION_ASYNCEVALUATION_H
+
+#if defined(__has_include)
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#define SPECIATION_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef SPECIATION_HAS_COROUTINES
+
+#include "GenusSeed.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace speciation {
+
+/**
+ * Lazy coroutine returning a value of type T.
+ * It starts only when awaited, and resumes the awaiting coroutine when finished.
+ *
+ * @tparam T type of the returned value
+ */
+template<typename T>
+class Task {
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                std::coroutine_handle<> continuation = handle.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_value(T v) { value = std::move(v); }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+public:
+    Task(const Task &) = delete;
+    Task& operator=(const Task &) = delete;
+    Task(Task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task &&other) noexcept
+    {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    ~Task()
+    {
+        if (handle) handle.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume()
+    {
+        if (handle.promise().error)
+            std::rethrow_exception(handle.promise().error);
+        return std::move(*handle.promise().value);
+    }
+};
+
+/**
+ * Small single-threaded event loop for coroutines.
+ *
+ * Coroutines are resumed only by the thread calling `run()`. `post()` is thread-safe, so I/O completions
+ * coming from other threads can resume their coroutine on the loop (see `Completion`).
+ */
+class EventLoop {
+    using clock = std::chrono::steady_clock;
+    struct Timer {
+        clock::time_point deadline;
+        uint64_t sequence;
+        std::coroutine_handle<> handle;
+        bool operator>(const Timer &other) const {
+            return deadline != other.deadline ? deadline > other.deadline : sequence > other.sequence;
+        }
+    };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::coroutine_handle<> > ready;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer> > timers;
+    uint64_t timer_sequence = 0;
+    std::atomic<size_t> outstanding_work{0};
+
+public:
+    EventLoop() = default;
+    EventLoop(const EventLoop &) = delete;
+    EventLoop& operator=(const EventLoop &) = delete;
+
+    /**
+     * Schedules a coroutine to be resumed by the loop. Thread-safe.
+     */
+    void post(std::coroutine_handle<> handle)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back(handle);
+        }
+        cv.notify_one();
+    }
+
+    /**
+     * Awaitable that suspends the current coroutine and resumes it from the loop queue.
+     */
+    auto schedule()
+    {
+        struct Awaiter {
+            EventLoop &loop;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { loop.post(handle); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    /**
+     * Awaitable that resumes the current coroutine after `duration`, without blocking the loop.
+     */
+    template<typename Rep, typename Period>
+    auto sleep_for(std::chrono::duration<Rep, Period> duration)
+    {
+        struct Awaiter {
+            EventLoop &loop;
+            clock::time_point deadline;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(loop.mutex);
+                    loop.timers.push(Timer{deadline, loop.timer_sequence++, handle});
+                }
+                loop.cv.notify_one();
+            }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this, clock::now() + std::chrono::duration_cast<clock::duration>(duration)};
+    }
+
+    /// Registers work that will post to the loop in the future: `run()` does not return while there is some
+    void work_started() { outstanding_work++; }
+    void work_finished()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            outstanding_work--;
+        }
+        cv.notify_one();
+    }
+
+    /**
+     * Resumes coroutines until there are no ready coroutines, no timers and no outstanding work.
+     */
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            if (!timers.empty() && timers.top().deadline <= clock::now()) {
+                std::coroutine_handle<> handle = timers.top().handle;
+                timers.pop();
+                ready.push_back(handle);
+            }
+
+            if (!ready.empty()) {
+                std::coroutine_handle<> handle = ready.front();
+                ready.pop_front();
+                lock.unlock();
+                handle.resume();
+                lock.lock();
+                continue;
+            }
+
+            if (timers.empty() && outstanding_work == 0)
+                return;
+
+            if (!timers.empty())
+                cv.wait_until(lock, timers.top().deadline);
+            else
+                cv.wait(lock);
+        }
+    }
+};
+
+/**
+ * One-shot value that can be set from any thread and awaited by a coroutine running on an `EventLoop`.
+ * The awaiting coroutine is resumed on its loop. It's the bridge between callback based I/O and `Task`s.
+ *
+ * Copies share the same state.
+ */
+template<typename T>
+class Completion {
+    struct State {
+        EventLoop &loop;
+        std::mutex mutex;
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> waiter;
+        explicit State(EventLoop &loop) : loop(loop) {}
+    };
+    std::shared_ptr<State> state;
+
+    void _complete(std::unique_lock<std::mutex> &lock)
+    {
+        std::coroutine_handle<> waiter = std::exchange(state->waiter, nullptr);
+        lock.unlock();
+        if (waiter) {
+            state->loop.post(waiter);
+            state->loop.work_finished();
+        }
+    }
+
+public:
+    explicit Completion(EventLoop &loop) : state(std::make_shared<State>(loop)) {}
+
+    void set_value(T value)
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->value = std::move(value);
+        _complete(lock);
+    }
+
+    void set_exception(std::exception_ptr error)
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->error = error;
+        _complete(lock);
+    }
+
+    bool await_ready() const
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->value.has_value() || state->error;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->value.has_value() || state->error)
+            return false;
+        state->waiter = handle;
+        // keep the loop alive until the value arrives
+        state->loop.work_started();
+        return true;
+    }
+
+    T await_resume()
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->error) std::rethrow_exception(state->error);
+        return std::move(*state->value);
+    }
+};
+
+namespace detail {
+/// Eagerly started coroutine that nobody awaits, it destroys itself when done.
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+}
+
+/**
+ * Evaluates a range of individuals with an asynchronous evaluator: thousands of evaluations can be in flight on a
+ * handful of threads, while they wait on I/O.
+ *
+ * The individuals are split between `threads` event loops, each one running in its own thread, with at most
+ * `max_in_flight` evaluations in progress per loop (0 = unlimited).
+ * The evaluator has the same contract as in `GenusSeed::evaluate` (it sets the fitness in the individual and returns
+ * it), but it returns a `Task<F>`. It's called on the loop thread and must resume only on its loop
+ * (e.g. through `EventLoop::sleep_for` or `Completion`).
+ *
+ * The first exception thrown by an evaluator is rethrown once all started evaluations are finished.
+ *
+ * @tparam Iter iterator of `I*`
+ * @tparam Evaluator callable `Task<F>(I*, EventLoop&)`
+ */
+template<typename F, typename Iter, typename Evaluator>
+void evaluate_async(Iter begin, Iter end, Evaluator evaluator, unsigned int threads = 1, size_t max_in_flight = 0)
+{
+    using I = typename std::remove_pointer<typename std::iterator_traits<Iter>::value_type>::type;
+
+    struct LoopState {
+        EventLoop loop;
+        std::vector<I *> individuals;
+        size_t next = 0;
+        size_t running = 0;
+        size_t max_in_flight = 0;
+        std::exception_ptr error;
+    };
+
+    if (threads == 0) threads = 1;
+    std::vector<std::unique_ptr<LoopState> > loops;
+    for (unsigned int i = 0; i < threads; i++) {
+        loops.emplace_back(std::make_unique<LoopState>());
+        loops.back()->max_in_flight = max_in_flight;
+    }
+    size_t i = 0;
+    for (Iter it = begin; it != end; it++, i++) {
+        loops[i % threads]->individuals.push_back(*it);
+    }
+
+    struct Runner {
+        static detail::Detached evaluate_one(LoopState &state, Evaluator &evaluator, I *individual)
+        {
+            // Start on the loop queue, so that evaluations completing synchronously do not recurse
+            co_await state.loop.schedule();
+            try {
+                F fitness = co_await evaluator(individual, state.loop);
+                auto individual_fitness = individual->fitness();
+                assert(individual_fitness == fitness);
+                (void) fitness; (void) individual_fitness;
+            } catch (...) {
+                if (!state.error) state.error = std::current_exception();
+            }
+            state.running--;
+            state.loop.work_finished();
+            launch(state, evaluator);
+        }
+
+        static void launch(LoopState &state, Evaluator &evaluator)
+        {
+            while (!state.error && state.next < state.individuals.size()
+                   && (state.max_in_flight == 0 || state.running < state.max_in_flight)) {
+                I *individual = state.individuals[state.next++];
+                state.running++;
+                state.loop.work_started();
+                evaluate_one(state, evaluator, individual);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::unique_ptr<LoopState> &state : loops) {
+        workers.emplace_back([&state, evaluator]() mutable {
+            Runner::launch(*state, evaluator);
+            state->loop.run();
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    for (std::unique_ptr<LoopState> &state : loops) {
+        if (state->error) std::rethrow_exception(state->error);
+    }
+}
+
+/**
+ * Evaluates all the new individuals of the seed with an asynchronous evaluator.
+ * Coroutine counterpart of `GenusSeed::evaluate`, see `evaluate_async` for the details.
+ */
+template<typename I, typename F, typename Evaluator>
+void evaluate_async(GenusSeed<I, F> &seed, Evaluator evaluator, unsigned int threads = 1, size_t max_in_flight = 0)
+{
+    evaluate_async<F>(seed.begin(), seed.end(), std::move(evaluator), threads, max_in_flight);
+}
+
+}
+
+#endif // SPECIATION_HAS_COROUTINES
+
+#endif //SPECIATION_ASYNCEVALUATION_H
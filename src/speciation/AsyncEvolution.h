@@ -0,0 +1,478 @@
+#ifndef SPECIATION_ASYNCEVOLUTION_H
+#define SPECIATION_ASYNCEVOLUTION_H
+
+#include "Species.h"
+#include "Conf.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace speciation {
+
+/**
+ * Asynchronous steady-state evolution, without generations.
+ *
+ * A fixed number of evaluation slots (threads) is kept busy all the time: as soon as an evaluation is finished,
+ * the new individual is inserted in its species (parent species first, then any compatible species, otherwise a
+ * new species), the worst individual of the species most over its quota is removed, and a new offspring is
+ * generated and sent to the free slot.
+ *
+ * Species bookkeeping is updated incrementally: only the species that changed get their adjusted fitness
+ * recomputed. The offspring quota of a species is its share of the total adjusted fitness, and new offspring are
+ * generated from the species with the biggest deficit (quota - individuals - evaluations in flight).
+ * Every `Conf::total_population_size` evaluations count as one generation for the species age and for the adaptive
+ * compatibility threshold (`Conf::target_species`). As in `Genus`, the individuals not compatible with any species
+ * join the species with the nearest representative when `Conf::max_species` is reached.
+ *
+ * @tparam I individual type
+ * @tparam F fitness type, it must have a negative infinity value
+ */
+template<typename I, typename F>
+class AsyncEvolution {
+public:
+    using const_iterator = typename Species<I, F>::const_iterator;
+    using Selection = std::function<const_iterator(const_iterator, const_iterator)>;
+    using ParentSelection = std::function<std::pair<const_iterator, const_iterator>(const_iterator, const_iterator)>;
+    using Reproduce1 = std::function<std::unique_ptr<I>(const I&)>;
+    using Reproduce2 = std::function<std::unique_ptr<I>(const I&, const I&)>;
+    using Mutate = std::function<void(I&)>;
+    /// Called concurrently from the evaluation threads, it must be thread-safe.
+    using Evaluate = std::function<F(I*)>;
+
+private:
+    struct Task {
+        std::unique_ptr<I> individual;
+        /// 0 if the individual has no parent species
+        unsigned int parent_species_id;
+    };
+
+    const Conf conf;
+    const unsigned int evaluation_slots;
+
+    std::vector<Species<I, F> > species_list;
+    /// Sum of the adjusted fitness of each species (same index of species_list)
+    std::vector<F> species_share;
+    /// Evaluations in flight generated from each species (same index of species_list)
+    std::vector<unsigned int> species_in_flight;
+    unsigned int next_species_id;
+    size_t _evaluations;
+    /// Current compatibility threshold, see `Conf::compatibility_threshold`
+    double compatibility_threshold;
+
+    // Evaluation threads
+    std::mutex mutex;
+    std::condition_variable todo_cv;
+    std::condition_variable done_cv;
+    std::deque<Task> todo;
+    std::deque<Task> done;
+    std::exception_ptr error;
+    bool stopping;
+
+public:
+    /**
+     * @param conf Species configuration object
+     * @param evaluation_slots number of evaluations to keep in flight (number of evaluation threads)
+     */
+    AsyncEvolution(const Conf &conf, unsigned int evaluation_slots)
+            : conf(conf)
+            , evaluation_slots(evaluation_slots)
+            , next_species_id(1)
+            , _evaluations(0)
+            , compatibility_threshold(conf.compatibility_threshold)
+            , stopping(false)
+    {
+        if (evaluation_slots == 0)
+            throw std::invalid_argument("AsyncEvolution needs at least one evaluation slot");
+    }
+
+    /**
+     * Evaluates (if needed) and speciates the initial population.
+     *
+     * WARNING! THIS FUNCTION TAKES OWNERSHIP OF THE SOURCE ITERATOR FOR INDIVIDUALS
+     *
+     * @tparam Iterator non-const iterator of std::unique_ptr<I> individuals.
+     * @param first, last initial population, its size should be `Conf::total_population_size`
+     * @param evaluate function to evaluate the individuals without fitness
+     */
+    template<typename Iterator>
+    void initialize(Iterator first, Iterator last, const Evaluate &evaluate)
+    {
+        std::vector<Task> tasks;
+        for (; first != last; first++) {
+            tasks.push_back(Task{std::move(*first), 0});
+        }
+        if (tasks.empty())
+            throw std::invalid_argument("Initial population cannot be empty");
+
+        _run_workers(evaluate, [&]() {
+            size_t in_flight = 0;
+            for (Task &task : tasks) {
+                if (!task.individual->fitness().has_value()) {
+                    _submit(std::move(task));
+                    in_flight++;
+                } else {
+                    _insert(std::move(task));
+                }
+            }
+            for (; in_flight > 0; in_flight--) {
+                _insert(_wait_one());
+            }
+        });
+    }
+
+    /**
+     * Evolves the population for `max_evaluations` evaluations.
+     * It can be called multiple times to continue the evolution.
+     *
+     * @param selection function to select 1 parent
+     * @param parent_selection function to select 2 parents (only called if crossover is enabled)
+     * @param reproduce_individual_1 function to create a new individual from 1 parent
+     * @param crossover_individual_2 function to create a new individual from 2 parents
+     * @param mutate_individual function that mutates an individual
+     * @param evaluate function to evaluate new individuals, called concurrently from `evaluation_slots` threads
+     * @param max_evaluations number of new individuals to evaluate
+     */
+    void run(const Selection &selection,
+             const ParentSelection &parent_selection,
+             const Reproduce1 &reproduce_individual_1,
+             const Reproduce2 &crossover_individual_2,
+             const Mutate &mutate_individual,
+             const Evaluate &evaluate,
+             size_t max_evaluations)
+    {
+        if (species_list.empty())
+            throw std::logic_error("AsyncEvolution::initialize() must be called before run()");
+
+        _run_workers(evaluate, [&]() {
+            size_t started = 0;
+            size_t in_flight = 0;
+            while (in_flight > 0 || started < max_evaluations) {
+                // Fill all free slots
+                while (in_flight < evaluation_slots && started < max_evaluations) {
+                    _submit(_generate_offspring(selection, parent_selection,
+                                                reproduce_individual_1, crossover_individual_2, mutate_individual));
+                    started++;
+                    in_flight++;
+                }
+
+                _insert(_wait_one());
+                in_flight--;
+            }
+        });
+    }
+
+private:
+    /**
+     * Starts the evaluation threads, runs `body` in the current thread and stops the threads.
+     */
+    template<typename Body>
+    void _run_workers(const Evaluate &evaluate, const Body &body)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = false;
+            error = nullptr;
+        }
+
+        std::vector<std::thread> threads;
+        for (unsigned int i = 0; i < evaluation_slots; i++) {
+            threads.emplace_back([this, &evaluate]() { _worker(evaluate); });
+        }
+
+        std::exception_ptr body_error;
+        try {
+            body();
+        } catch (...) {
+            body_error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        todo_cv.notify_all();
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        todo.clear();
+        done.clear();
+
+        if (body_error) std::rethrow_exception(body_error);
+    }
+
+    void _worker(const Evaluate &evaluate)
+    {
+        for (;;) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                todo_cv.wait(lock, [this]() { return stopping || !todo.empty(); });
+                if (stopping) return;
+                task = std::move(todo.front());
+                todo.pop_front();
+            }
+
+            try {
+                evaluate(task.individual.get());
+                assert(task.individual->fitness().has_value());
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.push_back(std::move(task));
+            }
+            done_cv.notify_one();
+        }
+    }
+
+    void _submit(Task &&task)
+    {
+        const int parent_i = _species_index(task.parent_species_id);
+        if (parent_i >= 0) species_in_flight[parent_i]++;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            todo.push_back(std::move(task));
+        }
+        todo_cv.notify_one();
+    }
+
+    Task _wait_one()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [this]() { return !done.empty(); });
+        if (error) std::rethrow_exception(error);
+        Task task = std::move(done.front());
+        done.pop_front();
+        lock.unlock();
+
+        const int parent_i = _species_index(task.parent_species_id);
+        if (parent_i >= 0) species_in_flight[parent_i]--;
+        return task;
+    }
+
+    Task _generate_offspring(const Selection &selection,
+                             const ParentSelection &parent_selection,
+                             const Reproduce1 &reproduce_1,
+                             const Reproduce2 &reproduce_2,
+                             const Mutate &mutate)
+    {
+        // Species with the biggest deficit with respect to its quota
+        const F total_share = _total_share();
+        size_t parent_species_i = 0;
+        double biggest_deficit = -std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < species_list.size(); i++) {
+            const double deficit = _quota(i, total_share)
+                                   - static_cast<double>(species_list[i].size() + species_in_flight[i]);
+            if (deficit > biggest_deficit) {
+                biggest_deficit = deficit;
+                parent_species_i = i;
+            }
+        }
+
+        const Species<I, F> &species = species_list[parent_species_i];
+        std::unique_ptr<I> child;
+        if (conf.crossover && species.size() > 1) {
+            std::pair<const_iterator, const_iterator> parents = parent_selection(species.cbegin(), species.cend());
+            child = reproduce_2(*parents.first->individual, *parents.second->individual);
+        } else {
+            const_iterator parent = selection(species.cbegin(), species.cend());
+            child = reproduce_1(*parent->individual);
+        }
+        mutate(*child);
+
+        return Task{std::move(child), species.id()};
+    }
+
+    /**
+     * Inserts an evaluated individual and keeps the population size constant.
+     */
+    void _insert(Task &&task)
+    {
+        // Parent species first, then any compatible species, then the nearest species if the cap is reached,
+        // otherwise a new species
+        int species_i = _species_index(task.parent_species_id);
+        if (species_i < 0 || !species_list[species_i].is_compatible(*task.individual, compatibility_threshold)) {
+            species_i = -1;
+            for (size_t i = 0; i < species_list.size(); i++) {
+                if (species_list[i].is_compatible(*task.individual, compatibility_threshold)) {
+                    species_i = static_cast<int>(i);
+                    break;
+                }
+            }
+        }
+        if (species_i < 0 && conf.max_species > 0 && species_list.size() >= conf.max_species) {
+            const size_t nearest = speciation::nearest_species(species_list.size(), [this](size_t s) -> const I* {
+                return species_list[s].empty() ? nullptr : &species_list[s].representative();
+            }, *task.individual);
+            if (nearest < species_list.size())
+                species_i = static_cast<int>(nearest);
+        }
+        if (species_i < 0) {
+            species_list.emplace_back(std::move(task.individual), next_species_id);
+            species_share.emplace_back(0);
+            species_in_flight.emplace_back(0);
+            next_species_id++;
+            species_i = static_cast<int>(species_list.size() - 1);
+        } else {
+            species_list[species_i].insert(std::move(task.individual));
+        }
+        _update_species(species_i);
+
+        if (count_individuals() > conf.total_population_size) {
+            _remove_worst();
+        }
+
+        if (task.parent_species_id != 0) {
+            _evaluations++;
+            if (_evaluations % conf.total_population_size == 0) {
+                _increase_age();
+            }
+        }
+    }
+
+    /**
+     * Removes the worst individual of the species that is most over its quota
+     */
+    void _remove_worst()
+    {
+        const F total_share = _total_share();
+        size_t species_i = 0;
+        double biggest_excess = -std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < species_list.size(); i++) {
+            const double excess = static_cast<double>(species_list[i].size()) - _quota(i, total_share);
+            if (excess > biggest_excess) {
+                biggest_excess = excess;
+                species_i = i;
+            }
+        }
+
+        Species<I, F> &species = species_list[species_i];
+        size_t worst = 0;
+        for (size_t i = 1; i < species.size(); i++) {
+            if (species.individual(i).fitness() < species.individual(worst).fitness())
+                worst = i;
+        }
+        species.remove(worst);
+
+        if (species.empty()) {
+            species_list.erase(species_list.begin() + species_i);
+            species_share.erase(species_share.begin() + species_i);
+            species_in_flight.erase(species_in_flight.begin() + species_i);
+        } else {
+            _update_species(species_i);
+        }
+    }
+
+    /**
+     * Recomputes the adjusted fitness of a single species
+     */
+    void _update_species(size_t species_i)
+    {
+        Species<I, F> &species = species_list[species_i];
+        species.compute_adjust_fitness(species_i == _best_species_index(), conf);
+        F share = 0;
+        for (const typename Species<I, F>::Indiv &indiv : species) {
+            share += indiv.adjusted_fitness.value();
+        }
+        species_share[species_i] = share;
+    }
+
+    void _increase_age()
+    {
+        const size_t best = _best_species_index();
+        for (size_t i = 0; i < species_list.size(); i++) {
+            species_list[i].increase_generations();
+            species_list[i].increase_no_improvements_generations();
+            if (i == best) species_list[i].reset_age();
+        }
+        compatibility_threshold = next_compatibility_threshold(compatibility_threshold, species_list.size(), conf);
+    }
+
+    [[nodiscard]] size_t _best_species_index() const
+    {
+        size_t best = 0;
+        for (size_t i = 1; i < species_list.size(); i++) {
+            if (species_list[i].get_best_fitness() > species_list[best].get_best_fitness())
+                best = i;
+        }
+        return best;
+    }
+
+    [[nodiscard]] int _species_index(unsigned int species_id) const
+    {
+        if (species_id == 0) return -1;
+        for (size_t i = 0; i < species_list.size(); i++) {
+            if (species_list[i].id() == species_id) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    [[nodiscard]] F _total_share() const
+    {
+        return std::accumulate(species_share.begin(), species_share.end(), F(0));
+    }
+
+    [[nodiscard]] double _quota(size_t species_i, F total_share) const
+    {
+        if (total_share <= 0)
+            return static_cast<double>(conf.total_population_size) / species_list.size();
+        return static_cast<double>(conf.total_population_size) * species_share[species_i] / total_share;
+    }
+
+public:
+    // Relay functions
+    /**
+     * Number of species
+     */
+    [[nodiscard]] size_t size() const {
+        return species_list.size();
+    }
+
+    /**
+     * Number of offspring evaluated so far (initial population excluded)
+     */
+    [[nodiscard]] size_t evaluations() const {
+        return _evaluations;
+    }
+
+    /**
+     * Current compatibility threshold, adapted every `Conf::total_population_size` evaluations when
+     * `Conf::target_species` is set
+     */
+    [[nodiscard]] double get_compatibility_threshold() const {
+        return compatibility_threshold;
+    }
+
+    [[nodiscard]] size_t count_individuals() const {
+        size_t count = 0;
+        for (const Species<I, F> &species : species_list) count += species.size();
+        return count;
+    }
+
+    [[nodiscard]] std::optional<F> best_fitness() const {
+        if (species_list.empty()) return std::nullopt;
+        return species_list[_best_species_index()].get_best_fitness();
+    }
+
+    typename std::vector<Species<I, F> >::const_iterator begin() const {
+        return species_list.cbegin();
+    }
+
+    typename std::vector<Species<I, F> >::const_iterator end() const {
+        return species_list.cend();
+    }
+};
+
+}
+
+#endif //SPECIATION_ASYNCEVOLUTION_H
@@ -0,0 +1,117 @@
+#ifndef SPECIATION_BOUNDEDQUEUE_H
+#define SPECIATION_BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+
+namespace speciation {
+
+/**
+ * Lock-free bounded multi-producer multi-consumer queue (Dmitry Vyukov's algorithm).
+ * Pushing and popping never block: when the queue is full (or empty) the operation just fails.
+ *
+ * @tparam T element type, it must be default constructible and movable
+ */
+template<typename T>
+class BoundedQueue {
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    static constexpr size_t CACHE_LINE = 64;
+
+    std::unique_ptr<Cell[]> buffer;
+    const size_t mask;
+    alignas(CACHE_LINE) std::atomic<size_t> enqueue_pos;
+    alignas(CACHE_LINE) std::atomic<size_t> dequeue_pos;
+
+    static size_t round_up_power_of_2(size_t n)
+    {
+        size_t power = 2;
+        while (power < n) power <<= 1u;
+        return power;
+    }
+
+public:
+    /**
+     * @param capacity minimum number of elements the queue can hold, rounded up to a power of 2
+     */
+    explicit BoundedQueue(size_t capacity)
+            : buffer(new Cell[round_up_power_of_2(capacity)])
+            , mask(round_up_power_of_2(capacity) - 1)
+            , enqueue_pos(0)
+            , dequeue_pos(0)
+    {
+        for (size_t i = 0; i <= mask; i++) {
+            buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue& operator=(const BoundedQueue &) = delete;
+
+    /**
+     * Tries to insert an element at the end of the queue
+     * @param value element to insert, it is moved only if the insertion succeeds
+     * @return false if the queue is full
+     */
+    bool try_push(T &&value)
+    {
+        Cell *cell;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &buffer[pos & mask];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Tries to extract the first element of the queue
+     * @param value where to move the extracted element
+     * @return false if the queue is empty
+     */
+    bool try_pop(T &value)
+    {
+        Cell *cell;
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &buffer[pos & mask];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->data);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] size_t capacity() const {
+        return mask + 1;
+    }
+};
+
+}
+
+#endif //SPECIATION_BOUNDEDQUEUE_H
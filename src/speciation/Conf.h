@@ -5,6 +5,9 @@
 #ifndef SPECIATION_CONF_H
 #define SPECIATION_CONF_H
 
+#include <algorithm>
+#include <cstddef>
+
 namespace speciation {
 struct Conf {
     /// Total population size
@@ -25,7 +28,44 @@ struct Conf {
     double young_age_fitness_boost = 1.1;
     /// multiplier for the fitness of old species (keep > 0 and < 1)
     double old_age_fitness_penalty = 0.9;
+
+    // COMPATIBILITY THRESHOLD
+
+    /// threshold passed to `I::is_compatible(other, threshold)`, for the individuals implementing it
+    /// (bigger = more individuals are compatible). It's the starting value when `target_species` is set.
+    double compatibility_threshold = 1.0;
+    /// if > 0, the compatibility threshold is adapted every generation to steer the number of species towards it
+    unsigned int target_species = 0;
+    /// change of the adaptive compatibility threshold at every generation
+    double compatibility_threshold_step = 0.1;
+    /// lower bound of the adaptive compatibility threshold
+    double min_compatibility_threshold = 0.1;
+    /// upper bound of the adaptive compatibility threshold, it stops growing when `target_species` can't be reached
+    double max_compatibility_threshold = 10.0;
+    /// if > 0, maximum number of species: when it's reached, the individuals not compatible with any species join
+    /// the species with the nearest representative (the individuals must implement `double distance(const I&) const`)
+    unsigned int max_species = 0;
 };
+
+/**
+ * Next value of the compatibility threshold.
+ * Fixed threshold: it follows `conf.compatibility_threshold`.
+ * Adaptive threshold (NEAT's dynamic threshold): it moves by one step towards `conf.target_species` species, between
+ * `conf.min_compatibility_threshold` and `conf.max_compatibility_threshold`.
+ *
+ * @param compatibility_threshold current threshold
+ * @param n_species current number of species
+ */
+inline double next_compatibility_threshold(double compatibility_threshold, size_t n_species, const Conf &conf)
+{
+    if (conf.target_species == 0)
+        return conf.compatibility_threshold;
+    if (n_species > conf.target_species)
+        return std::min(compatibility_threshold + conf.compatibility_threshold_step, conf.max_compatibility_threshold);
+    if (n_species < conf.target_species)
+        return std::max(compatibility_threshold - conf.compatibility_threshold_step, conf.min_compatibility_threshold);
+    return compatibility_threshold;
+}
 }
 
 #endif //SPECIATION_CONF_H
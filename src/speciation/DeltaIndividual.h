@@ -0,0 +1,218 @@
+#ifndef SPECIATION_DELTAINDIVIDUAL_H
+#define SPECIATION_DELTAINDIVIDUAL_H
+
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace speciation {
+
+/**
+ * Offspring stored as a reference to an ancestor genome plus the mutations applied since (delta encoding).
+ *
+ * Most offspring differ from their parent by a few mutations: `clone()` shares the ancestor genome and copies only
+ * the list of mutations, `mutate()` appends one. The population then holds a few full genomes, shared, and a small
+ * delta per individual. The genome is materialized only when needed, by `genome()` (evaluation, crossover):
+ * - if the individual is the last one referring to its ancestor genome (the parent died), the mutations are applied
+ *   in place and the individual keeps the result, without any copy (compaction);
+ * - otherwise the materialized genome is a temporary copy, freed when the caller releases it.
+ * `compact()` materializes the genome and keeps it. It happens automatically when the mutations exceed `max_deltas`,
+ * and for the individual on which `is_compatible` is called, the species representative, so that its genome is not
+ * materialized again for every compatibility check.
+ * The candidate passed to `is_compatible` and `distance` is not compacted, so that the offspring keep sharing their
+ * ancestor genome: while its ancestor is alive, every check copies its genome. Checking an offspring against many
+ * species costs a copy per species, unless it's compacted first.
+ *
+ * Thread safe: every individual has its own lock, held by all the methods.
+ *
+ * @tparam Genome full genome, it must provide `Genome clone() const` and `bool is_compatible(const Genome&) const`
+ * (`is_compatible(other, threshold)` and `distance(other)` are used too, if provided)
+ * @tparam Delta a mutation, it must provide `void apply(Genome &genome) const`
+ * @tparam F fitness type
+ */
+template<typename Genome, typename Delta, typename F>
+class DeltaIndividual {
+    mutable std::mutex mutex;
+    /// Materialized ancestor genome, never modified while shared
+    mutable std::shared_ptr<Genome> base;
+    /// Mutations to apply to `base`, in order
+    mutable std::vector<Delta> deltas;
+    std::optional<F> _fitness;
+    unsigned int max_deltas;
+
+public:
+    /**
+     * @param genome the full genome
+     * @param max_deltas maximum number of mutations before the genome is materialized again
+     */
+    explicit DeltaIndividual(Genome &&genome, unsigned int max_deltas = 64)
+            : base(std::make_shared<Genome>(std::move(genome)))
+            , max_deltas(max_deltas)
+    {}
+
+    DeltaIndividual(const DeltaIndividual &other)
+    {
+        std::lock_guard<std::mutex> lock(other.mutex);
+        base = other.base;
+        deltas = other.deltas;
+        _fitness = other._fitness;
+        max_deltas = other.max_deltas;
+    }
+
+    DeltaIndividual(DeltaIndividual &&other) noexcept
+    {
+        std::lock_guard<std::mutex> lock(other.mutex);
+        base = std::move(other.base);
+        deltas = std::move(other.deltas);
+        _fitness = other._fitness;
+        max_deltas = other.max_deltas;
+    }
+
+    DeltaIndividual& operator=(const DeltaIndividual &other)
+    {
+        if (this != &other) {
+            std::scoped_lock lock(mutex, other.mutex);
+            base = other.base;
+            deltas = other.deltas;
+            _fitness = other._fitness;
+            max_deltas = other.max_deltas;
+        }
+        return *this;
+    }
+
+    DeltaIndividual& operator=(DeltaIndividual &&other) noexcept
+    {
+        if (this != &other) {
+            std::scoped_lock lock(mutex, other.mutex);
+            base = std::move(other.base);
+            deltas = std::move(other.deltas);
+            _fitness = other._fitness;
+            max_deltas = other.max_deltas;
+        }
+        return *this;
+    }
+
+    // Individual interface
+    [[nodiscard]] std::optional<F> fitness() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return _fitness;
+    }
+
+    void set_fitness(F fitness)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        _fitness = fitness;
+    }
+
+    /**
+     * @return a copy sharing the genome, only the mutations are copied
+     */
+    [[nodiscard]] DeltaIndividual clone() const { return DeltaIndividual(*this); }
+
+    [[nodiscard]] bool is_compatible(const DeltaIndividual &other) const
+    {
+        std::shared_ptr<const Genome> genome = compact();
+        return genome->is_compatible(*other.genome());
+    }
+
+    /// Only if `Genome` implements `is_compatible(other, threshold)`
+    template<typename G = Genome>
+    [[nodiscard]] auto is_compatible(const DeltaIndividual &other, double threshold) const
+            -> decltype(std::declval<const G&>().is_compatible(std::declval<const G&>(), threshold))
+    {
+        std::shared_ptr<const Genome> genome = compact();
+        return genome->is_compatible(*other.genome(), threshold);
+    }
+
+    /// Only if `Genome` implements `distance(other)`
+    template<typename G = Genome>
+    [[nodiscard]] auto distance(const DeltaIndividual &other) const
+            -> decltype(std::declval<const G&>().distance(std::declval<const G&>()))
+    {
+        std::shared_ptr<const Genome> genome = compact();
+        return genome->distance(*other.genome());
+    }
+
+    /**
+     * Adds a mutation, the fitness is reset.
+     */
+    void mutate(Delta delta)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            deltas.emplace_back(std::move(delta));
+            _fitness.reset();
+            if (deltas.size() <= max_deltas) return;
+        }
+        compact();
+    }
+
+    /**
+     * The full genome, with all the mutations applied.
+     * The individual keeps it only if it was the last one referring to its ancestor genome, otherwise it's a
+     * temporary copy.
+     */
+    [[nodiscard]] std::shared_ptr<const Genome> genome() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (deltas.empty())
+            return base;
+        if (base.use_count() == 1) {
+            _apply_deltas(*base);
+            return base;
+        }
+        std::shared_ptr<Genome> materialized = std::make_shared<Genome>(base->clone());
+        _apply_deltas(*materialized);
+        return materialized;
+    }
+
+    /**
+     * Materializes the genome and keeps it: the individual does not refer to its ancestor genome anymore.
+     * @return the full genome
+     */
+    std::shared_ptr<const Genome> compact() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!deltas.empty()) {
+            if (base.use_count() > 1)
+                base = std::make_shared<Genome>(base->clone());
+            _apply_deltas(*base);
+        }
+        return base;
+    }
+
+    // Statistics
+    /// Number of mutations not applied to the genome yet
+    [[nodiscard]] size_t delta_count() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return deltas.size();
+    }
+
+    /// The ancestor genome, shared with the other individuals referring to it
+    [[nodiscard]] const Genome* base_genome() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return base.get();
+    }
+
+private:
+    /// Applies the mutations to `genome`, to be called with the lock. The mutations are kept unless `genome` is the base.
+    void _apply_deltas(Genome &genome) const
+    {
+        for (const Delta &delta : deltas)
+            delta.apply(genome);
+        if (&genome == base.get()) {
+            assert(base.use_count() == 1);
+            deltas.clear();
+        }
+    }
+};
+
+}
+
+#endif //SPECIATION_DELTAINDIVIDUAL_H
@@ -0,0 +1,288 @@
+#ifndef SPECIATION_EXECUTOR_H
+#define SPECIATION_EXECUTOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace speciation {
+
+/**
+ * Scheduler of the parallel phases of the evolution (speciation, offspring generation, evaluation,
+ * population management, orphan adoption).
+ *
+ * Implement it to plug in your own scheduler.
+ */
+class Executor {
+public:
+    virtual ~Executor() = default;
+
+    /**
+     * Calls `body(i)` for every i in [0, n) and waits for all of them.
+     * It can be called from inside a `body` (nested parallelism).
+     * The first exception thrown is rethrown once all the calls are finished.
+     */
+    virtual void parallel_for(size_t n, const std::function<void(size_t)> &body) = 0;
+
+    /// Number of threads running the tasks
+    [[nodiscard]] virtual unsigned int concurrency() const = 0;
+
+    /**
+     * Assigns the species of a generation to the nodes of the executor (e.g. NUMA nodes), see `parallel_for_nodes`.
+     * By default there is a single node.
+     * @param species_ids id of each species
+     * @param loads load of each species (e.g. number of offspring), in the same order
+     * @return node of each species, in the same order
+     */
+    virtual std::vector<unsigned int> place_species(const std::vector<unsigned int> &species_ids,
+                                                    const std::vector<unsigned int> &loads)
+    {
+        (void) loads;
+        return std::vector<unsigned int>(species_ids.size(), 0);
+    }
+
+    /**
+     * Same as `parallel_for(task_nodes.size(), body)`, with `body(i)` called by a thread with affinity to the node
+     * `task_nodes[i]`. By default the nodes are ignored.
+     */
+    virtual void parallel_for_nodes(const std::vector<unsigned int> &task_nodes,
+                                    const std::function<void(size_t)> &body)
+    {
+        parallel_for(task_nodes.size(), body);
+    }
+};
+
+/**
+ * Runs everything on the calling thread, in order.
+ */
+class SequentialExecutor final : public Executor {
+public:
+    void parallel_for(size_t n, const std::function<void(size_t)> &body) override
+    {
+        for (size_t i = 0; i < n; i++) body(i);
+    }
+
+    [[nodiscard]] unsigned int concurrency() const override { return 1; }
+};
+
+/**
+ * Thread pool with work stealing.
+ *
+ * Every worker has its own deque of tasks: it pushes and pops at the back (last in, first out, cache friendly), idle
+ * workers steal from the front of the others' deques. `parallel_for` splits the range in a few tasks per worker and
+ * the calling thread runs tasks too until there are none left, then it blocks until the tasks still running on other
+ * threads are finished: nested `parallel_for` (e.g. species, then offspring of each species) balance automatically
+ * and never deadlock.
+ */
+class WorkStealingExecutor final : public Executor {
+    /// Tasks of a single `parallel_for` call, with the latch the caller waits on
+    struct Group {
+        std::mutex mutex;
+        std::condition_variable done;
+        /// guarded by `mutex`
+        size_t pending;
+        std::atomic<bool> failed;
+        std::exception_ptr error;
+    };
+
+    struct Task {
+        const std::function<void(size_t)> *body;
+        size_t begin;
+        size_t end;
+        Group *group;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker> > workers;
+    std::vector<std::thread> threads;
+
+    std::mutex sleep_mutex;
+    std::condition_variable wake_up;
+    /// Tasks in the deques, updated under the lock of the deque
+    std::atomic<size_t> queued;
+    bool stopping;
+    /// Deque used by the threads outside of the pool
+    std::atomic<size_t> next_external;
+
+public:
+    /**
+     * @param n_threads number of worker threads, 0 for `std::thread::hardware_concurrency()`
+     */
+    explicit WorkStealingExecutor(unsigned int n_threads = 0)
+            : queued(0)
+            , stopping(false)
+            , next_external(0)
+    {
+        if (n_threads == 0)
+            n_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        for (unsigned int w = 0; w < n_threads; w++)
+            workers.emplace_back(std::make_unique<Worker>());
+        for (unsigned int w = 0; w < n_threads; w++)
+            threads.emplace_back([this, w]() { _worker_loop(w); });
+    }
+
+    WorkStealingExecutor(const WorkStealingExecutor &) = delete;
+    WorkStealingExecutor& operator=(const WorkStealingExecutor &) = delete;
+
+    ~WorkStealingExecutor() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wake_up.notify_all();
+        for (std::thread &thread : threads) thread.join();
+    }
+
+    void parallel_for(size_t n, const std::function<void(size_t)> &body) override
+    {
+        if (n == 0) return;
+        if (n == 1) {
+            body(0);
+            return;
+        }
+
+        // a few tasks per worker, so that they can be stolen
+        const size_t grain = std::max<size_t>(1, n / (4 * workers.size()));
+        const size_t n_tasks = (n + grain - 1) / grain;
+
+        Group group;
+        group.pending = n_tasks;
+        group.failed = false;
+
+        const long self = _current_worker();
+        const size_t target = self >= 0 ? static_cast<size_t>(self) : next_external++ % workers.size();
+        {
+            std::lock_guard<std::mutex> lock(workers[target]->mutex);
+            // pushed in reverse, so that the owner pops them in order
+            for (size_t t = n_tasks; t-- > 0;) {
+                const size_t begin = t * grain;
+                workers[target]->tasks.push_back(Task{&body, begin, std::min(begin + grain, n), &group});
+            }
+            queued += n_tasks;
+        }
+        {
+            // orders the update of `queued` with the sleeping workers' check of it: a worker either sees it or is
+            // already waiting, and gets the notification
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
+        wake_up.notify_all();
+
+        // run the tasks while there are some, then wait for the ones running on other threads
+        bool pending = true;
+        while (pending && _run_one(target)) {
+            std::lock_guard<std::mutex> lock(group.mutex);
+            pending = group.pending > 0;
+        }
+        {
+            std::unique_lock<std::mutex> lock(group.mutex);
+            group.done.wait(lock, [&group]() { return group.pending == 0; });
+        }
+
+        if (group.error) std::rethrow_exception(group.error);
+    }
+
+    [[nodiscard]] unsigned int concurrency() const override
+    {
+        return static_cast<unsigned int>(workers.size());
+    }
+
+private:
+    /// Index of the calling worker thread of this pool, -1 for other threads
+    long _current_worker() const
+    {
+        if (_thread_pool() != this) return -1;
+        return _thread_worker();
+    }
+
+    static const WorkStealingExecutor*& _thread_pool()
+    {
+        static thread_local const WorkStealingExecutor *pool = nullptr;
+        return pool;
+    }
+
+    static long& _thread_worker()
+    {
+        static thread_local long worker = -1;
+        return worker;
+    }
+
+    void _worker_loop(size_t w)
+    {
+        _thread_pool() = this;
+        _thread_worker() = static_cast<long>(w);
+        for (;;) {
+            if (_run_one(w)) continue;
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake_up.wait(lock, [this]() { return stopping || queued > 0; });
+            if (stopping) return;
+        }
+    }
+
+    /**
+     * Runs a task: from the back of the deque of `w`, otherwise stolen from the front of another deque.
+     * @return false if there was nothing to run
+     */
+    bool _run_one(size_t w)
+    {
+        std::optional<Task> task = _pop(w);
+        for (size_t k = 1; !task.has_value() && k < workers.size(); k++)
+            task = _steal((w + k) % workers.size());
+        if (!task.has_value())
+            return false;
+
+        Group &group = *task->group;
+        if (!group.failed) {
+            try {
+                for (size_t i = task->begin; i < task->end; i++)
+                    (*task->body)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(group.mutex);
+                if (!group.error) group.error = std::current_exception();
+                group.failed = true;
+            }
+        }
+        // notified under the lock: the group is destroyed as soon as the caller sees no pending tasks
+        std::lock_guard<std::mutex> lock(group.mutex);
+        if (--group.pending == 0) group.done.notify_all();
+        return true;
+    }
+
+    std::optional<Task> _pop(size_t w)
+    {
+        Worker &worker = *workers[w];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) return std::nullopt;
+        Task task = worker.tasks.back();
+        worker.tasks.pop_back();
+        queued--;
+        return task;
+    }
+
+    std::optional<Task> _steal(size_t victim)
+    {
+        Worker &worker = *workers[victim];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) return std::nullopt;
+        Task task = worker.tasks.front();
+        worker.tasks.pop_front();
+        queued--;
+        return task;
+    }
+};
+
+}
+
+#endif //SPECIATION_EXECUTOR_H
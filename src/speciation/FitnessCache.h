@@ -0,0 +1,223 @@
+#ifndef SPECIATION_FITNESSCACHE_H
+#define SPECIATION_FITNESSCACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace speciation {
+
+/**
+ * Bounded concurrent cache of fitness values, keyed by genome.
+ * It avoids evaluating again offspring identical to an already evaluated individual.
+ *
+ * The table is split in shards, each with its own lock, and the least recently used entries are evicted
+ * with the CLOCK (second chance) algorithm when a shard is full.
+ *
+ * @tparam Key genome representation (e.g. std::vector<bool>)
+ * @tparam F fitness type
+ * @tparam Hash hash function for Key
+ * @tparam KeyEqual equality function for Key
+ */
+template<typename Key, typename F, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key> >
+class FitnessCache {
+    /// Key to position in the CLOCK ring
+    using Index = std::unordered_map<Key, size_t, Hash, KeyEqual>;
+
+    struct Entry {
+        /// The key is stored only once, in the index. Its iterators are stable: the index never rehashes
+        typename Index::iterator position;
+        F fitness;
+        bool referenced;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        Index index;
+        std::vector<Entry> entries;
+        size_t hand = 0;
+
+        Shard(size_t capacity, const Hash &hash, const KeyEqual &equal)
+                : index(capacity, hash, equal)
+        {
+            index.reserve(capacity);
+            entries.reserve(capacity);
+        }
+    };
+
+    const size_t shard_capacity;
+    Hash hash;
+    std::vector<std::unique_ptr<Shard> > shards;
+
+    std::atomic<size_t> _hits;
+    std::atomic<size_t> _misses;
+    std::atomic<size_t> _evictions;
+
+    Shard& _shard(const Key &key)
+    {
+        // mix the hash, the low bits are also used by the shard's unordered_map
+        uint64_t h = static_cast<uint64_t>(hash(key)) * 0x9E3779B97F4A7C15ull;
+        return *shards[(h >> 32u) % shards.size()];
+    }
+
+public:
+    /**
+     * @param capacity maximum number of cached fitnesses (split evenly between the shards)
+     * @param n_shards number of independently locked shards
+     */
+    explicit FitnessCache(size_t capacity, size_t n_shards = 16, Hash hash = Hash(), KeyEqual equal = KeyEqual())
+            : shard_capacity((capacity + n_shards - 1) / std::max<size_t>(n_shards, 1))
+            , hash(hash)
+            , _hits(0)
+            , _misses(0)
+            , _evictions(0)
+    {
+        if (capacity == 0 || n_shards == 0)
+            throw std::invalid_argument("FitnessCache capacity and number of shards must be greater than zero");
+        for (size_t i = 0; i < n_shards; i++) {
+            shards.emplace_back(std::make_unique<Shard>(shard_capacity, hash, equal));
+        }
+    }
+
+    /**
+     * Looks up the fitness of a genome, updating the hit statistics.
+     * @return the cached fitness, std::nullopt if not present
+     */
+    std::optional<F> find(const Key &key)
+    {
+        Shard &shard = _shard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            _misses++;
+            return std::nullopt;
+        }
+        _hits++;
+        Entry &entry = shard.entries[it->second];
+        entry.referenced = true;
+        return entry.fitness;
+    }
+
+    /**
+     * Stores the fitness of a genome, possibly evicting an old entry.
+     */
+    void insert(const Key &key, F fitness)
+    {
+        Shard &shard = _shard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            Entry &entry = shard.entries[it->second];
+            entry.fitness = fitness;
+            entry.referenced = true;
+            return;
+        }
+
+        if (shard.entries.size() < shard_capacity) {
+            const size_t slot = shard.entries.size();
+            shard.entries.push_back(Entry{shard.index.emplace(key, slot).first, fitness, false});
+        } else {
+            // CLOCK: give a second chance to the recently used entries
+            while (shard.entries[shard.hand].referenced) {
+                shard.entries[shard.hand].referenced = false;
+                shard.hand = (shard.hand + 1) % shard.entries.size();
+            }
+            const size_t slot = shard.hand;
+            shard.hand = (shard.hand + 1) % shard.entries.size();
+
+            Entry &victim = shard.entries[slot];
+            shard.index.erase(victim.position);
+            _evictions++;
+            victim.position = shard.index.emplace(key, slot).first;
+            victim.fitness = fitness;
+            victim.referenced = false;
+        }
+    }
+
+    /**
+     * Wraps an evaluation function with the cache. The returned function can be passed to
+     * `GenusSeed::evaluate()` or `Genus::ensure_evaluated_population()`.
+     * The cache must outlive the returned function.
+     *
+     * @param evaluate evaluation function, called only on cache misses
+     * @param key_of extracts the genome of an individual
+     * @param set_fitness stores a cached fitness in an individual
+     * @return cached evaluation function
+     */
+    template<typename I>
+    std::function<F(I*)> wrap(std::function<F(I*)> evaluate,
+                              std::function<Key(const I&)> key_of,
+                              std::function<void(I&, F)> set_fitness)
+    {
+        return [this, evaluate = std::move(evaluate), key_of = std::move(key_of), set_fitness = std::move(set_fitness)]
+                (I *individual) -> F {
+            Key key = key_of(*individual);
+            std::optional<F> cached = find(key);
+            if (cached.has_value()) {
+                set_fitness(*individual, cached.value());
+                return cached.value();
+            }
+            F fitness = evaluate(individual);
+            insert(key, fitness);
+            return fitness;
+        };
+    }
+
+    /**
+     * Removes all the entries, statistics are kept
+     */
+    void clear()
+    {
+        for (std::unique_ptr<Shard> &shard : shards) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->index.clear();
+            shard->entries.clear();
+            shard->hand = 0;
+        }
+    }
+
+    void reset_statistics()
+    {
+        _hits = 0;
+        _misses = 0;
+        _evictions = 0;
+    }
+
+    // Statistics
+    [[nodiscard]] size_t hits() const { return _hits; }
+    [[nodiscard]] size_t misses() const { return _misses; }
+    [[nodiscard]] size_t evictions() const { return _evictions; }
+    [[nodiscard]] double hit_rate() const
+    {
+        const size_t lookups = _hits + _misses;
+        return lookups == 0 ? 0.0 : static_cast<double>(_hits) / static_cast<double>(lookups);
+    }
+
+    /// Number of cached entries
+    [[nodiscard]] size_t size()
+    {
+        size_t count = 0;
+        for (std::unique_ptr<Shard> &shard : shards) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            count += shard->index.size();
+        }
+        return count;
+    }
+
+    [[nodiscard]] size_t capacity() const {
+        return shard_capacity * shards.size();
+    }
+};
+
+}
+
+#endif //SPECIATION_FITNESSCACHE_H
@@ -0,0 +1,391 @@
+#ifndef SPECIATION_FITNESSSTORE_H
+#define SPECIATION_FITNESSSTORE_H
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SPECIATION_HAS_FITNESS_STORE 1
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace speciation {
+
+/**
+ * 64 bits FNV-1a hash, handy to build genome hashes for the `FitnessStore`.
+ * @param data bytes to hash
+ * @param size number of bytes
+ * @param seed previous hash, to hash multiple buffers in sequence
+ */
+inline uint64_t fnv1a_64(const void *data, size_t size, uint64_t seed = 0xcbf29ce484222325ull)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/**
+ * Persistent append-only fitness store, keyed by genome hash.
+ *
+ * Replaying an experiment with the same seed produces the same genomes: with the store their fitness is read back
+ * from disk instead of being evaluated again.
+ * The file is memory-mapped and indexed when opened: the index maps every genome hash to the offset of its record,
+ * fitnesses are read from the mapping and never copied in memory. New fitnesses are appended with `O_APPEND` writes,
+ * so the same file can be shared by concurrent runs: read-only stores see the records appended afterwards with
+ * `refresh()`. The file creation and the appends are serialized with `flock`, so concurrent runs can create and
+ * write the same store.
+ * A truncated record at the end of the file (e.g. a writer crashed, or the disk was full) is never indexed, and a
+ * ReadWrite store cuts it off before appending: the records that follow stay aligned.
+ *
+ * The genome hash is trusted: two genomes with the same hash get the same fitness, use a good 64 bits hash.
+ * Only available on POSIX systems (`SPECIATION_HAS_FITNESS_STORE` is defined).
+ *
+ * @tparam F fitness type, it must be trivially copyable. It's stored in the native byte order.
+ */
+template<typename F>
+class FitnessStore {
+    static_assert(std::is_trivially_copyable<F>::value, "Fitness must be trivially copyable to be stored on disk");
+
+public:
+    enum class Mode {
+        ReadOnly,
+        ReadWrite,
+    };
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t fitness_size;
+    };
+    struct Record {
+        uint64_t hash;
+        F fitness;
+    };
+
+    static constexpr char MAGIC[8] = {'S', 'P', 'E', 'C', 'F', 'I', 'T', 'S'};
+    static constexpr uint32_t VERSION = 1;
+
+    const std::string path;
+    const Mode mode;
+    int fd;
+    /// Bytes of the file already indexed
+    size_t loaded_size;
+    /// Read-only mapping of the first `mapped_size` bytes of the file
+    const char *mapping;
+    size_t mapped_size;
+
+    std::mutex mutex;
+    /// Genome hash to offset of its record in the file
+    std::unordered_map<uint64_t, size_t> index;
+
+    std::atomic<size_t> _hits;
+    std::atomic<size_t> _misses;
+
+public:
+    /**
+     * Opens (and in ReadWrite mode creates, if needed) the store file and indexes its content.
+     * @param path file of the store
+     * @param mode ReadOnly stores never write to the file
+     */
+    explicit FitnessStore(std::string path, Mode mode = Mode::ReadWrite)
+            : path(std::move(path))
+            , mode(mode)
+            , fd(-1)
+            , loaded_size(0)
+            , mapping(nullptr)
+            , mapped_size(0)
+            , _hits(0)
+            , _misses(0)
+    {
+        const int flags = mode == Mode::ReadOnly ? O_RDONLY : (O_RDWR | O_CREAT | O_APPEND);
+        fd = open(this->path.c_str(), flags, 0644);
+        if (fd < 0)
+            _throw_errno("open");
+
+        try {
+            _check_header();
+            refresh();
+        } catch (...) {
+            _unmap();
+            close(fd);
+            throw;
+        }
+    }
+
+    FitnessStore(const FitnessStore &) = delete;
+    FitnessStore& operator=(const FitnessStore &) = delete;
+
+    ~FitnessStore()
+    {
+        _unmap();
+        if (fd >= 0) close(fd);
+    }
+
+    /**
+     * Looks up the fitness of a genome
+     * @param hash genome hash
+     * @return the stored fitness, std::nullopt if not present
+     */
+    std::optional<F> find(uint64_t hash)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(hash);
+        if (it == index.end()) {
+            _misses++;
+            return std::nullopt;
+        }
+        _hits++;
+        return _read_fitness(it->second);
+    }
+
+    /**
+     * Appends the fitness of a genome to the store. Nothing is written if the genome is already present.
+     * @param hash genome hash
+     * @param fitness fitness of the genome
+     */
+    void insert(uint64_t hash, F fitness)
+    {
+        if (mode == Mode::ReadOnly)
+            throw std::logic_error("FitnessStore: cannot insert in a read-only store");
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (index.find(hash) != index.end())
+            return;
+
+        Record record{};
+        record.hash = hash;
+        record.fitness = fitness;
+        _lock_file(LOCK_EX);
+        try {
+            const size_t offset = _truncate_torn_record();
+            // A single O_APPEND write, so that records of concurrent writers do not interleave
+            const ssize_t written = write(fd, &record, sizeof(record));
+            if (written != static_cast<ssize_t>(sizeof(record))) {
+                // do not leave part of the record behind (e.g. the disk is full)
+                const int write_errno = written < 0 ? errno : ENOSPC;
+                if (written > 0 && ftruncate(fd, static_cast<off_t>(offset)) != 0)
+                    _throw_errno("ftruncate");
+                errno = write_errno;
+                _throw_errno("write");
+            }
+            index.emplace(hash, offset);
+        } catch (...) {
+            flock(fd, LOCK_UN);
+            throw;
+        }
+        flock(fd, LOCK_UN);
+    }
+
+    /**
+     * Indexes the records appended to the file (by this or other processes) since the last refresh.
+     * @return number of new records
+     */
+    size_t refresh()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) != 0)
+            _throw_errno("fstat");
+        const size_t file_size = static_cast<size_t>(file_stat.st_size);
+        // only complete records
+        const size_t records_end = sizeof(Header) + (file_size - sizeof(Header)) / sizeof(Record) * sizeof(Record);
+        if (records_end <= loaded_size)
+            return 0;
+
+        _map(records_end);
+        size_t new_records = 0;
+        for (size_t offset = std::max(loaded_size, sizeof(Header)); offset < records_end; offset += sizeof(Record)) {
+            uint64_t hash;
+            std::memcpy(&hash, mapping + offset + offsetof(Record, hash), sizeof(hash));
+            if (index.emplace(hash, offset).second)
+                new_records++;
+        }
+
+        loaded_size = records_end;
+        return new_records;
+    }
+
+    /**
+     * Flushes the appended records to the disk
+     */
+    void sync()
+    {
+        if (mode == Mode::ReadWrite && fsync(fd) != 0)
+            _throw_errno("fsync");
+    }
+
+    /**
+     * Wraps an evaluation function with the store, like `FitnessCache::wrap()`.
+     * The returned function can be passed to `GenusSeed::evaluate()` or `Genus::ensure_evaluated_population()`.
+     * In ReadOnly mode, new fitnesses are not stored.
+     *
+     * @param evaluate evaluation function, called only for genomes not in the store
+     * @param hash_of computes the genome hash of an individual
+     * @param set_fitness stores a fitness read from the store in an individual
+     */
+    template<typename I>
+    std::function<F(I*)> wrap(std::function<F(I*)> evaluate,
+                              std::function<uint64_t(const I&)> hash_of,
+                              std::function<void(I&, F)> set_fitness)
+    {
+        return [this, evaluate = std::move(evaluate), hash_of = std::move(hash_of), set_fitness = std::move(set_fitness)]
+                (I *individual) -> F {
+            const uint64_t hash = hash_of(*individual);
+            std::optional<F> stored = find(hash);
+            if (stored.has_value()) {
+                set_fitness(*individual, stored.value());
+                return stored.value();
+            }
+            F fitness = evaluate(individual);
+            if (mode == Mode::ReadWrite)
+                insert(hash, fitness);
+            return fitness;
+        };
+    }
+
+    /// Number of indexed genomes
+    [[nodiscard]] size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return index.size();
+    }
+
+    [[nodiscard]] size_t hits() const { return _hits; }
+    [[nodiscard]] size_t misses() const { return _misses; }
+
+private:
+    [[noreturn]] void _throw_errno(const char *what) const
+    {
+        std::stringstream error_message;
+        error_message << "FitnessStore(" << path << "): " << what << " failed: " << std::strerror(errno);
+        throw std::runtime_error(error_message.str());
+    }
+
+    /// Maps the first `size` bytes of the file, replacing the previous mapping
+    void _map(size_t size)
+    {
+        void *new_mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (new_mapping == MAP_FAILED)
+            _throw_errno("mmap");
+        _unmap();
+        mapping = static_cast<const char *>(new_mapping);
+        mapped_size = size;
+    }
+
+    void _unmap()
+    {
+        if (mapping != nullptr)
+            munmap(const_cast<char *>(mapping), mapped_size);
+        mapping = nullptr;
+        mapped_size = 0;
+    }
+
+    /// Fitness of the record at `offset`, to be called with the lock
+    F _read_fitness(size_t offset)
+    {
+        F fitness;
+        if (offset + sizeof(Record) <= mapped_size) {
+            std::memcpy(&fitness, mapping + offset + offsetof(Record, fitness), sizeof(F));
+        } else {
+            // appended by this store after the last refresh
+            if (pread(fd, &fitness, sizeof(F), static_cast<off_t>(offset + offsetof(Record, fitness)))
+                != static_cast<ssize_t>(sizeof(F)))
+                _throw_errno("pread");
+        }
+        return fitness;
+    }
+
+    void _lock_file(int operation)
+    {
+        if (flock(fd, operation) != 0)
+            _throw_errno("flock");
+    }
+
+    /**
+     * Cuts off a truncated record at the end of the file, to be called by a ReadWrite store holding the file lock.
+     * @return size of the file, the offset of the next appended record
+     */
+    size_t _truncate_torn_record()
+    {
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) != 0)
+            _throw_errno("fstat");
+        const size_t file_size = static_cast<size_t>(file_stat.st_size);
+        const size_t records_end = sizeof(Header) + (file_size - sizeof(Header)) / sizeof(Record) * sizeof(Record);
+        if (records_end != file_size && ftruncate(fd, static_cast<off_t>(records_end)) != 0)
+            _throw_errno("ftruncate");
+        return records_end;
+    }
+
+    void _check_header()
+    {
+        // concurrent runs creating the same file must not both write the header
+        _lock_file(mode == Mode::ReadWrite ? LOCK_EX : LOCK_SH);
+        try {
+            _check_header_locked();
+            if (mode == Mode::ReadWrite)
+                _truncate_torn_record();
+        } catch (...) {
+            flock(fd, LOCK_UN);
+            throw;
+        }
+        flock(fd, LOCK_UN);
+    }
+
+    void _check_header_locked()
+    {
+        Header expected{};
+        std::memcpy(expected.magic, MAGIC, sizeof(MAGIC));
+        expected.version = VERSION;
+        expected.fitness_size = sizeof(F);
+
+        Header header{};
+        const ssize_t n_read = pread(fd, &header, sizeof(header), 0);
+        if (n_read < 0)
+            _throw_errno("pread");
+
+        if (n_read == 0 && mode == Mode::ReadWrite) {
+            // new file
+            if (write(fd, &expected, sizeof(expected)) != static_cast<ssize_t>(sizeof(expected)))
+                _throw_errno("write");
+            return;
+        }
+
+        if (static_cast<size_t>(n_read) != sizeof(header)
+            || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+            || header.version != VERSION
+            || header.fitness_size != sizeof(F)) {
+            std::stringstream error_message;
+            error_message << "FitnessStore(" << path << "): not a fitness store, or incompatible fitness type";
+            throw std::runtime_error(error_message.str());
+        }
+    }
+};
+
+}
+
+#endif // unix
+
+#endif //SPECIATION_FITNESSSTORE_H
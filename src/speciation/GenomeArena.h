@@ -0,0 +1,313 @@
+#ifndef SPECIATION_GENOMEARENA_H
+#define SPECIATION_GENOMEARENA_H
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SPECIATION_HAS_GENOME_ARENA 1
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace speciation {
+
+/**
+ * Out-of-core storage for genomes larger than the memory.
+ *
+ * Genome payloads are written once, when the individual is created, in a file arena. Individuals keep only a
+ * `GenomeArena::Handle` to their payload, together with the in-memory metadata needed by speciation and selection
+ * (fitness, sketch, see `IndividualPrototype::is_compatible`). The payload is memory-mapped on demand with `read()`,
+ * during reproduction and evaluation, and unmapped when the `View` is destroyed: the kernel pages it in and out of the
+ * page cache, so the resident memory is bounded by the genomes currently in use, not by the population size.
+ *
+ * Payloads are immutable and shared between the handles (e.g. with `clone()`), the space of a payload is reused by
+ * new payloads when its last handle is destroyed. The arena must outlive all its handles.
+ * Writing, reading and releasing payloads is thread safe.
+ * Only available on POSIX systems (`SPECIATION_HAS_GENOME_ARENA` is defined).
+ */
+class GenomeArena {
+    struct Extent {
+        uint64_t offset;
+        /// Bytes reserved, multiple of the page size
+        uint64_t capacity;
+    };
+
+    struct Payload {
+        GenomeArena *arena;
+        Extent extent;
+        size_t size;
+
+        Payload(GenomeArena *arena, const Extent &extent, size_t size)
+                : arena(arena), extent(extent), size(size) {}
+        Payload(const Payload &) = delete;
+        Payload& operator=(const Payload &) = delete;
+        ~Payload() { arena->_release(extent); }
+    };
+
+public:
+    /**
+     * Shared reference to an immutable payload in the arena.
+     */
+    class Handle {
+        std::shared_ptr<const Payload> payload;
+        friend class GenomeArena;
+
+        explicit Handle(std::shared_ptr<const Payload> payload) : payload(std::move(payload)) {}
+
+    public:
+        Handle() = default;
+
+        /// Size of the payload in bytes
+        [[nodiscard]] size_t size() const { return payload ? payload->size : 0; }
+        explicit operator bool() const { return static_cast<bool>(payload); }
+    };
+
+    /**
+     * Read-only mapping of a payload, the memory is unmapped when the view is destroyed.
+     */
+    class View {
+        void *mapping;
+        size_t mapping_size;
+        size_t _size;
+        friend class GenomeArena;
+
+        View(void *mapping, size_t mapping_size, size_t size)
+                : mapping(mapping), mapping_size(mapping_size), _size(size) {}
+
+    public:
+        View(const View &) = delete;
+        View& operator=(const View &) = delete;
+
+        View(View &&other) noexcept
+                : mapping(other.mapping), mapping_size(other.mapping_size), _size(other._size)
+        {
+            other.mapping = nullptr;
+            other.mapping_size = 0;
+            other._size = 0;
+        }
+
+        View& operator=(View &&other) noexcept
+        {
+            if (this != &other) {
+                _unmap();
+                mapping = std::exchange(other.mapping, nullptr);
+                mapping_size = std::exchange(other.mapping_size, 0);
+                _size = std::exchange(other._size, 0);
+            }
+            return *this;
+        }
+
+        ~View() { _unmap(); }
+
+        [[nodiscard]] const unsigned char* data() const { return static_cast<const unsigned char *>(mapping); }
+        [[nodiscard]] size_t size() const { return _size; }
+        [[nodiscard]] const unsigned char* begin() const { return data(); }
+        [[nodiscard]] const unsigned char* end() const { return data() + _size; }
+
+        /// The payload as an array of `size() / sizeof(T)` elements of `T`
+        template<typename T>
+        [[nodiscard]] const T* as() const
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be mapped");
+            return reinterpret_cast<const T *>(mapping);
+        }
+
+    private:
+        void _unmap()
+        {
+            if (mapping != nullptr) munmap(mapping, mapping_size);
+            mapping = nullptr;
+        }
+    };
+
+private:
+    const std::string path;
+    const uint64_t page_size;
+    int fd;
+
+    std::mutex mutex;
+    /// End of the used part of the file
+    uint64_t end;
+    /// Released extents, by capacity
+    std::multimap<uint64_t, uint64_t> free_extents;
+    uint64_t _live_bytes;
+
+    std::atomic<size_t> _reads;
+    std::atomic<size_t> _bytes_written;
+
+public:
+    /**
+     * Creates the arena file, truncating it if it exists.
+     * @param path file of the arena
+     * @param keep_file if false, the file is unlinked right away and its space is freed when the arena is destroyed
+     */
+    explicit GenomeArena(std::string path, bool keep_file = false)
+            : path(std::move(path))
+            , page_size(static_cast<uint64_t>(sysconf(_SC_PAGESIZE)))
+            , fd(-1)
+            , end(0)
+            , _live_bytes(0)
+            , _reads(0)
+            , _bytes_written(0)
+    {
+        fd = open(this->path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            _throw_errno("open");
+        if (!keep_file && unlink(this->path.c_str()) != 0) {
+            close(fd);
+            _throw_errno("unlink");
+        }
+    }
+
+    GenomeArena(const GenomeArena &) = delete;
+    GenomeArena& operator=(const GenomeArena &) = delete;
+
+    ~GenomeArena()
+    {
+        if (fd >= 0) close(fd);
+    }
+
+    /**
+     * Writes a new payload in the arena.
+     * @param data bytes of the payload
+     * @param size number of bytes
+     * @return handle to the payload
+     */
+    Handle write(const void *data, size_t size)
+    {
+        const Extent extent = _allocate(size);
+        try {
+            const char *bytes = static_cast<const char *>(data);
+            size_t written = 0;
+            while (written < size) {
+                const ssize_t n = pwrite(fd, bytes + written, size - written,
+                                         static_cast<off_t>(extent.offset + written));
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    _throw_errno("pwrite");
+                }
+                written += static_cast<size_t>(n);
+            }
+        } catch (...) {
+            _release(extent);
+            throw;
+        }
+        _bytes_written += size;
+        return Handle(std::make_shared<const Payload>(this, extent, size));
+    }
+
+    /**
+     * Writes a vector of trivially copyable elements as a new payload
+     */
+    template<typename T>
+    Handle write(const std::vector<T> &elements)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be written");
+        return write(elements.data(), elements.size() * sizeof(T));
+    }
+
+    /**
+     * Maps a payload in memory, read-only.
+     * @param handle payload of this arena
+     * @return view of the payload, valid as long as the handle
+     */
+    [[nodiscard]] View read(const Handle &handle)
+    {
+        if (!handle || handle.payload->arena != this)
+            throw std::invalid_argument("GenomeArena: the handle does not belong to this arena");
+        _reads++;
+        const Payload &payload = *handle.payload;
+        if (payload.size == 0)
+            return View(nullptr, 0, 0);
+
+        void *mapping = mmap(nullptr, payload.size, PROT_READ, MAP_SHARED, fd,
+                             static_cast<off_t>(payload.extent.offset));
+        if (mapping == MAP_FAILED)
+            _throw_errno("mmap");
+        return View(mapping, payload.size, payload.size);
+    }
+
+    /// Reads a payload written with `write(const std::vector<T>&)` back in memory
+    template<typename T>
+    [[nodiscard]] std::vector<T> read_vector(const Handle &handle)
+    {
+        View view = read(handle);
+        return std::vector<T>(view.as<T>(), view.as<T>() + view.size() / sizeof(T));
+    }
+
+    // Statistics
+    /// Number of `read()` calls, i.e. payloads paged in
+    [[nodiscard]] size_t reads() const { return _reads; }
+    [[nodiscard]] size_t bytes_written() const { return _bytes_written; }
+    /// Bytes reserved by the payloads still referenced (rounded up to pages)
+    [[nodiscard]] uint64_t live_bytes()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return _live_bytes;
+    }
+    /// Size of the arena file
+    [[nodiscard]] uint64_t file_size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return end;
+    }
+
+private:
+    [[noreturn]] void _throw_errno(const char *what) const
+    {
+        std::stringstream error_message;
+        error_message << "GenomeArena(" << path << "): " << what << " failed: " << std::strerror(errno);
+        throw std::runtime_error(error_message.str());
+    }
+
+    Extent _allocate(size_t size)
+    {
+        // extents are page aligned, so that payloads can be mapped directly
+        const uint64_t capacity = std::max<uint64_t>((size + page_size - 1) / page_size, 1) * page_size;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto free_extent = free_extents.lower_bound(capacity);
+        if (free_extent != free_extents.end()) {
+            // the reused extent can be larger than needed, it's released whole
+            Extent extent{free_extent->second, free_extent->first};
+            free_extents.erase(free_extent);
+            _live_bytes += extent.capacity;
+            return extent;
+        }
+
+        Extent extent{end, capacity};
+        if (ftruncate(fd, static_cast<off_t>(end + capacity)) != 0)
+            _throw_errno("ftruncate");
+        end += capacity;
+        _live_bytes += capacity;
+        return extent;
+    }
+
+    void _release(const Extent &extent)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        _live_bytes -= extent.capacity;
+        free_extents.emplace(extent.capacity, extent.offset);
+    }
+};
+
+}
+
+#endif // unix
+
+#endif //SPECIATION_GENOMEARENA_H
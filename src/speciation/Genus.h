@@ -7,12 +7,79 @@
 
 #include "SpeciesCollection.h"
 #include "GenusSeed.h"
+#include "Executor.h"
+#include "Random.h"
+#include "MultiObjective.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <forward_list>
+#include <functional>
 #include <cmath>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <thread>
 
 namespace speciation {
 
+/**
+ * Largest remainder (Hamilton) apportionment of `total` seats, proportionally to `weights`.
+ *
+ * Each entry gets the floor of its quota `total * weight / sum(weights)`, the remaining seats (less than the number
+ * of entries) go to the largest fractional remainders, ties are broken by lowest index.
+ * The result always sums exactly to `total`. If no weight is positive, the seats are split evenly.
+ *
+ * @param weights non negative weights (negative weights count as zero)
+ * @param total number of seats to distribute
+ * @return the number of seats of each entry, in the same order as `weights`
+ */
+inline std::vector<unsigned int> largest_remainder_apportionment(const std::vector<double> &weights, unsigned int total)
+{
+    const size_t n = weights.size();
+    std::vector<unsigned int> seats(n, 0);
+    if (n == 0 || total == 0)
+        return seats;
+
+    double weight_sum = 0.;
+    for (double weight : weights)
+        weight_sum += std::max(weight, 0.);
+    const bool even = !(weight_sum > 0.) || !std::isfinite(weight_sum);
+
+    std::vector<double> remainders(n);
+    unsigned int assigned = 0;
+    for (size_t i = 0; i < n; i++) {
+        const double share = even ? 1. / static_cast<double>(n) : std::max(weights[i], 0.) / weight_sum;
+        const double quota = std::min(static_cast<double>(total) * share, static_cast<double>(total));
+        const double floor_quota = std::floor(quota);
+        seats[i] = static_cast<unsigned int>(floor_quota);
+        remainders[i] = quota - floor_quota;
+        assigned += seats[i];
+    }
+
+    // sum of the floors <= sum of the quotas == total, and the remainders sum to less than n
+    assert(assigned <= total);
+    size_t missing = total - assigned;
+    if (missing >= n) {
+        // only reachable through floating point errors, when the quotas sum slightly below total
+        for (unsigned int &entry_seats : seats)
+            entry_seats += static_cast<unsigned int>(missing / n);
+        missing %= n;
+    }
+    if (missing > 0) {
+        std::vector<size_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::partial_sort(order.begin(), order.begin() + missing, order.end(),
+                [&remainders](size_t a, size_t b) {
+                    return remainders[a] > remainders[b] || (remainders[a] == remainders[b] && a < b);
+                });
+        for (size_t i = 0; i < missing; i++)
+            seats[order[i]]++;
+    }
+
+    return seats;
+}
+
 /**
  * Collection of species
  * @tparam I individual type, it must provide a fitness through a function `std::optional<F> fitness()`
@@ -24,6 +91,12 @@ class Genus {
     unsigned int next_species_id;
     /// Species Collection
     SpeciesCollection<I,F> species_collection;
+    /// Current compatibility threshold, see `Conf::compatibility_threshold`
+    double compatibility_threshold;
+    /// Maximum number of species, 0 if unbounded. See `Conf::max_species`
+    unsigned int max_species;
+    /// Number of generations created with `next_generation`
+    unsigned int _generation;
 
 public:
     /**
@@ -31,16 +104,28 @@ public:
      */
     Genus()
             : next_species_id(1)
+            , compatibility_threshold(Conf().compatibility_threshold)
+            , max_species(0)
+            , _generation(0)
     {}
 
     /**
      * Creates a new Genus object from a pre existing SpeciesCollection
      * @param species_collection
      * @param next_species_id id of the next new species
+     * @param compatibility_threshold current compatibility threshold
+     * @param max_species maximum number of species, 0 if unbounded
+     * @param generation generation number, see `generation()`
      */
-    Genus(SpeciesCollection<I, F> species_collection, unsigned int next_species_id)
+    Genus(SpeciesCollection<I, F> species_collection, unsigned int next_species_id,
+          double compatibility_threshold = Conf().compatibility_threshold,
+          unsigned int max_species = 0,
+          unsigned int generation = 0)
             : next_species_id(next_species_id)
             , species_collection(std::move(species_collection))
+            , compatibility_threshold(compatibility_threshold)
+            , max_species(max_species)
+            , _generation(generation)
     {}
 
     /**
@@ -49,6 +134,9 @@ public:
     Genus(Genus &&other) noexcept
             : next_species_id(other.next_species_id)
             , species_collection(std::move(other.species_collection))
+            , compatibility_threshold(other.compatibility_threshold)
+            , max_species(other.max_species)
+            , _generation(other._generation)
     {}
 
     /**
@@ -62,6 +150,9 @@ public:
 
         next_species_id = other.next_species_id;
         species_collection = std::move(other.species_collection);
+        compatibility_threshold = other.compatibility_threshold;
+        max_species = other.max_species;
+        _generation = other._generation;
         return *this;
     }
 
@@ -73,6 +164,37 @@ public:
      *
      * @tparam Iterator non-const iterator of std::unique_ptr<I> individuals.
      * @param fist, last: the range of elements to sum
+     * @param conf Species configuration object, the compatibility threshold starts from `conf.compatibility_threshold`
+     * and the number of species is limited by `conf.max_species`
+     */
+    template< typename Iterator >
+    void speciate(Iterator first, Iterator last, const Conf &conf) {
+        compatibility_threshold = conf.compatibility_threshold;
+        max_species = conf.max_species;
+        speciate(first, last);
+    }
+
+    /**
+     * Same as `speciate(first, last, conf)`, with the compatibility checks run by `executor`.
+     * With a parallel executor, `I::is_compatible` must be thread safe. The species are the same for any executor.
+     */
+    template< typename Iterator >
+    void speciate(Iterator first, Iterator last, const Conf &conf, Executor &executor) {
+        assert(first != last);
+        compatibility_threshold = conf.compatibility_threshold;
+        max_species = conf.max_species;
+
+        species_collection.clear();
+        std::vector<std::unique_ptr<I> > individuals;
+        for (; first != last; first++) {
+            individuals.emplace_back(std::move(*first));
+        }
+        _adopt_orphans_parallel(individuals, species_collection, next_species_id, executor);
+    }
+
+    /**
+     * Creates the species, with the current compatibility threshold and maximum number of species.
+     * See `speciate(first, last, conf)`.
      */
     template< typename Iterator >
     void speciate(Iterator first, Iterator last) {
@@ -93,19 +215,64 @@ public:
             // Find compatible species
             for (; species_it != species_end; species_it++) {
                 Species<I,F> &species = *species_it;
-                if (species.is_compatible(*individual)) {
+                if (species.is_compatible(*individual, compatibility_threshold)) {
                     species.insert(std::move(individual));
                     break;
                 }
             }
             // No compatible species was found
-            if (species_it == species_end) {
+            if (species_it == species_end && !_insert_in_nearest_species(species_collection, individual)) {
                 species_collection.create_species(std::move(individual), next_species_id);
                 next_species_id++;
             }
         }
     }
 
+    /**
+     * Inserts a single individual (e.g. a migrant from another Genus) in the current species.
+     * It follows the same rules as the orphans: it joins the first compatible species,
+     * otherwise it creates a new species.
+     *
+     * The population will be bigger than `Conf::total_population_size` until the next generation is created.
+     * Remember to call `update()` afterwards, so that the new individual gets its adjusted fitness.
+     *
+     * @param individual the individual to insert, it must be already evaluated.
+     */
+    void insert_individual(std::unique_ptr<I> &&individual)
+    {
+        if (!species_collection.insert_in_compatible_species(individual, compatibility_threshold)
+            && !_insert_in_nearest_species(species_collection, individual)) {
+            species_collection.create_species(std::move(individual), next_species_id);
+            next_species_id++;
+        }
+    }
+
+    /**
+     * Finds the best individuals across all species.
+     * Individuals without fitness are considered the worst.
+     *
+     * @param k maximum number of individuals to return
+     * @return pointers to the best individuals, sorted from the best. Valid until this Genus is modified.
+     */
+    [[nodiscard]] std::vector<const I*> best_individuals(size_t k) const
+    {
+        std::vector<const I*> individuals;
+        individuals.reserve(count_individuals());
+        for (const Species<I, F> &species: species_collection) {
+            for (const typename Species<I, F>::Indiv &i : species) {
+                individuals.emplace_back(i.individual.get());
+            }
+        }
+
+        k = std::min(k, individuals.size());
+        std::partial_sort(individuals.begin(), individuals.begin() + k, individuals.end(),
+                          [](const I *a, const I *b) {
+                              return a->fitness() > b->fitness();
+                          });
+        individuals.resize(k);
+        return individuals;
+    }
+
     void ensure_evaluated_population(const std::function<F(I*)> &evaluate_individual)
     {
         for (const Species<I, F> &species: species_collection) {
@@ -121,8 +288,60 @@ public:
         }
     }
 
+    /**
+     * Same as `ensure_evaluated_population(evaluate_individual)`, with the evaluations run by `executor`.
+     * With a parallel executor, `evaluate_individual` must be thread safe.
+     */
+    void ensure_evaluated_population(const std::function<F(I*)> &evaluate_individual, Executor &executor)
+    {
+        std::vector<I*> need_evaluation;
+        for (const Species<I, F> &species: species_collection) {
+            for (const typename Species<I, F>::Indiv &i : species) {
+                if (!i.individual->fitness().has_value())
+                    need_evaluation.emplace_back(i.individual.get());
+            }
+        }
+        executor.parallel_for(need_evaluation.size(), [&](size_t i) {
+            F fitness = evaluate_individual(need_evaluation[i]);
+            assert(need_evaluation[i]->fitness().has_value());
+            assert(fitness == need_evaluation[i]->fitness().value());
+            (void) fitness;
+        });
+    }
+
+    /**
+     * Multi-objective mode: ranks the whole population by Pareto front and crowding distance, and stores the
+     * resulting scalar fitness in the individuals (see `assign_pareto_fitness` in MultiObjective.h).
+     * Call it before `update()`, once the new individuals are evaluated: the adjusted fitnesses, the offspring
+     * allocation and the selections then work on the ranks.
+     *
+     * @param objectives_of objectives of an individual (maximized)
+     * @param set_fitness stores the scalar fitness in the individual
+     */
+    void assign_pareto_fitness(const std::function<Objectives(const I&)> &objectives_of,
+                               const std::function<void(I&, F)> &set_fitness)
+    {
+        std::vector<I*> individuals;
+        individuals.reserve(count_individuals());
+        for (const Species<I, F> &species: species_collection) {
+            for (const typename Species<I, F>::Indiv &i : species) {
+                individuals.emplace_back(i.individual.get());
+            }
+        }
+        speciation::assign_pareto_fitness<I, F>(individuals, objectives_of, set_fitness);
+    }
+
+    /**
+     * Updates the species age and the adjusted fitnesses, to be called once per generation before generating
+     * the new individuals.
+     * With `conf.target_species` set, it also adapts the compatibility threshold: it's increased when there are too
+     * many species, decreased when there are too few.
+     */
     Genus& update(const Conf &conf)
     {
+        _update_compatibility_threshold(conf);
+        max_species = conf.max_species;
+
         // Update species stagnation and stuff
         species_collection.compute_update();
 
@@ -132,6 +351,20 @@ public:
         return *this;
     }
 
+    /**
+     * Same as `update(conf)`, with the adjusted fitnesses of the species computed by `executor`.
+     */
+    Genus& update(const Conf &conf, Executor &executor)
+    {
+        _update_compatibility_threshold(conf);
+        max_species = conf.max_species;
+
+        species_collection.compute_update();
+        species_collection.compute_adjust_fitness(conf, executor);
+
+        return *this;
+    }
+
      /**
       * Creates the genus for the next generation.
       * The species are copied over so that `this` Genus is not invalidated.
@@ -157,97 +390,190 @@ public:
             const std::function<void(I&)> &mutate_individual
     ) const
     {
+        return _generate_new_individuals(conf, [&](const Species<I, F> &species, size_t) {
+            return _generate_new_individual(conf, species.cbegin(), species.cend(), selection, parent_selection,
+                                            reproduce_individual_1, crossover_individual_2, mutate_individual);
+        }, nullptr);
+    }
 
-        // Calculate offspring amount
-        std::vector<unsigned int> offspring_amounts = _count_offsprings(conf.total_population_size);
-
-        // Clone Species
-        SpeciesCollection<I, F> new_species_collection;
-        std::vector<std::unique_ptr<I> > orphans;
-
-        // Pointers to values in new_species_collection and orphans
-        std::vector<I*> need_evaluation;
-
-        // Pointers to current const species_collection
-        std::vector<std::vector<const I*> > old_species_individuals;
-
-        //////////////////////////////////////////////
-        /// GENERATE NEW INDIVIDUALS
-        int species_i = 0;
-        for (const Species<I, F> &species : species_collection) {
-            old_species_individuals.emplace_back(species.size());
-
-            // Get the individuals from the individual with adjusted fitness tuple list.
-            std::transform(species.cbegin(), species.cend(),
-                    old_species_individuals.back().begin(),
-                    [](const typename Species<I,F>::Indiv &i)
-                    { return i.individual.get(); });
-
-            std::vector<std::unique_ptr<I> > new_individuals;
-
-            for (unsigned int n_offspring = 0; n_offspring < offspring_amounts[species_i]; n_offspring++) {
-                std::unique_ptr<I> new_individual = _generate_new_individual(
-                        conf,
-                        species.cbegin(), species.cend(),
-                        selection,
-                        parent_selection,
-                        reproduce_individual_1,
-                        crossover_individual_2,
-                        mutate_individual
-                );
-
-                // if the new individual is compatible with the species, otherwise create new.
-                if (species.is_compatible(*new_individual)) {
-                    new_individuals.emplace_back(std::move(new_individual));
-                    need_evaluation.emplace_back(new_individuals.back().get());
-                } else {
-                    orphans.emplace_back(std::move(new_individual));
-                    need_evaluation.emplace_back(orphans.back().get());
-                }
-            }
+    /**
+     * Same as `generate_new_individuals`, with the offspring generated by `executor`: the species in parallel and,
+     * nested, the offspring of each species.
+     * The species are placed on the nodes of the executor (see `Executor::place_species`): with a `NumaExecutor`, the
+     * offspring of each species are generated by threads of the NUMA node of the species, so that they are allocated
+     * on that node. Pass the same executor to `GenusSeed::evaluate` to evaluate them on the same node.
+     *
+     * All the functions are called concurrently, they must be thread safe.
+     * The result is the same as the sequential one, if the functions are deterministic.
+     */
+    GenusSeed<I,F> generate_new_individuals(
+            const Conf &conf,
+            const std::function<typename Species<I,F>::const_iterator (typename Species<I,F>::const_iterator, typename Species<I,F>::const_iterator)> &selection,
+            const std::function<std::pair<typename Species<I,F>::const_iterator,typename Species<I,F>::const_iterator>(typename Species<I,F>::const_iterator, typename Species<I,F>::const_iterator)> &parent_selection,
+            const std::function<std::unique_ptr<I>(const I&)> &reproduce_individual_1,
+            const std::function<std::unique_ptr<I>(const I&, const I&)> &crossover_individual_2,
+            const std::function<void(I&)> &mutate_individual,
+            Executor &executor
+    ) const
+    {
+        return _generate_new_individuals(conf, [&](const Species<I, F> &species, size_t) {
+            return _generate_new_individual(conf, species.cbegin(), species.cend(), selection, parent_selection,
+                                            reproduce_individual_1, crossover_individual_2, mutate_individual);
+        }, &executor);
+    }
 
-            new_species_collection.add_species(
-                    species.clone_with_new_individuals(std::move(new_individuals))
-                    );
+    /**
+     * Deterministic version of `generate_new_individuals`: every function gets the random generator of the offspring
+     * being generated, `streams.offspring(generation(), species id, offspring index)`.
+     * If the functions use no other source of randomness, the new individuals are the same for any executor and
+     * number of threads, bit for bit.
+     *
+     * All the functions are called concurrently, they must be thread safe.
+     */
+    GenusSeed<I,F> generate_new_individuals(
+            const Conf &conf,
+            const RandomStreams &streams,
+            const std::function<typename Species<I,F>::const_iterator (typename Species<I,F>::const_iterator, typename Species<I,F>::const_iterator, Philox4x32&)> &selection,
+            const std::function<std::pair<typename Species<I,F>::const_iterator,typename Species<I,F>::const_iterator>(typename Species<I,F>::const_iterator, typename Species<I,F>::const_iterator, Philox4x32&)> &parent_selection,
+            const std::function<std::unique_ptr<I>(const I&, Philox4x32&)> &reproduce_individual_1,
+            const std::function<std::unique_ptr<I>(const I&, const I&, Philox4x32&)> &crossover_individual_2,
+            const std::function<void(I&, Philox4x32&)> &mutate_individual,
+            Executor &executor
+    ) const
+    {
+        using Iter = typename Species<I,F>::const_iterator;
+        return _generate_new_individuals(conf, [&](const Species<I, F> &species, size_t n_offspring) {
+            Philox4x32 random = streams.offspring(_generation, species.id(), n_offspring);
+            return _generate_new_individual<Iter>(
+                    conf, species.cbegin(), species.cend(),
+                    [&](Iter begin, Iter end) { return selection(begin, end, random); },
+                    [&](Iter begin, Iter end) { return parent_selection(begin, end, random); },
+                    [&](const I &parent) { return reproduce_individual_1(parent, random); },
+                    [&](const I &parent1, const I &parent2) { return crossover_individual_2(parent1, parent2, random); },
+                    [&](I &child) { mutate_individual(child, random); });
+        }, &executor);
+    }
 
-            species_i++;
-        }
+    /**
+     * Creates the genus for the next generation, from the evaluated new individuals.
+     *
+     * @param conf Species configuration object
+     * @param generated_individuals the evaluated new individuals
+     * @param population_management function to create the new population of a species from its old and new
+     * individuals, size of the new population is passed in as a parameter.
+     * @return the genus of the next generation
+     */
+    Genus next_generation(const Conf &conf,
+                          GenusSeed<I, F> &&generated_individuals,
+                          const std::function<std::vector<std::unique_ptr<I> >(
+                                  std::vector<std::unique_ptr<I> > &&new_individuals,
+                                  const std::vector<const I *> &old_individuals,
+                                  unsigned int target_population)> &population_management) const
+    {
+        SequentialExecutor executor;
+        return next_generation(conf, std::move(generated_individuals), population_management, executor);
+    }
 
-        return GenusSeed(
-                std::move(orphans),
-                std::move(new_species_collection),
-                std::move(need_evaluation),
-                std::move(old_species_individuals));
+    /**
+     * Same as `next_generation(conf, generated_individuals, population_management)`, with the orphans adopted and
+     * the species populations managed by `executor`. Pass the same executor to every generation: its threads are
+     * shared by all the phases.
+     * With a parallel executor, `population_management` is called concurrently for different species, so it and
+     * `I::is_compatible` must be thread safe.
+     * The result is the same for any executor.
+     */
+    Genus next_generation(const Conf &conf,
+                          GenusSeed<I, F> &&generated_individuals,
+                          const std::function<std::vector<std::unique_ptr<I> >(
+                                  std::vector<std::unique_ptr<I> > &&new_individuals,
+                                  const std::vector<const I *> &old_individuals,
+                                  unsigned int target_population)> &population_management,
+                          Executor &executor) const
+    {
+        return _next_generation(conf, std::move(generated_individuals),
+                [&population_management](std::vector<std::unique_ptr<I> > &&new_individuals,
+                                         const std::vector<const I *> &old_individuals,
+                                         unsigned int target_population,
+                                         unsigned int) {
+                    return population_management(std::move(new_individuals), old_individuals, target_population);
+                }, executor);
     }
 
+    /**
+     * Deterministic version of `next_generation`: `population_management` gets the random generator of the species,
+     * `streams.species(generation(), species id)`.
+     * If it uses no other source of randomness, the next genus is the same for any executor and number of threads.
+     */
     Genus next_generation(const Conf &conf,
                           GenusSeed<I, F> &&generated_individuals,
                           const std::function<std::vector<std::unique_ptr<I> >(
                                   std::vector<std::unique_ptr<I> > &&new_individuals,
                                   const std::vector<const I *> &old_individuals,
-                                  unsigned int target_population)> &population_management) const
+                                  unsigned int target_population,
+                                  Philox4x32 &random)> &population_management,
+                          const RandomStreams &streams,
+                          Executor &executor) const
+    {
+        return _next_generation(conf, std::move(generated_individuals),
+                [&](std::vector<std::unique_ptr<I> > &&new_individuals,
+                    const std::vector<const I *> &old_individuals,
+                    unsigned int target_population,
+                    unsigned int species_id) {
+                    Philox4x32 random = streams.species(_generation, species_id);
+                    return population_management(std::move(new_individuals), old_individuals, target_population,
+                                                 random);
+                }, executor);
+    }
+
+    /**
+     * Number of the generation: 0 for a new genus, increased by one by every `next_generation`.
+     * Deterministic runs use it to derive their random streams, see `RandomStreams`.
+     */
+    [[nodiscard]] unsigned int generation() const {
+        return _generation;
+    }
+
+private:
+    /**
+     * @param population_management as in `next_generation`, with the id of the species as last parameter
+     */
+    Genus _next_generation(const Conf &conf,
+                           GenusSeed<I, F> &&generated_individuals,
+                           const std::function<std::vector<std::unique_ptr<I> >(
+                                   std::vector<std::unique_ptr<I> > &&new_individuals,
+                                   const std::vector<const I *> &old_individuals,
+                                   unsigned int target_population,
+                                   unsigned int species_id)> &population_management,
+                           Executor &executor) const
     {
+        const bool parallel = executor.concurrency() > 1;
         unsigned int local_next_species_id = this->next_species_id;
 
         //////////////////////////////////////////////
         /// MANAGE ORPHANS, POSSIBLY CREATE NEW SPECIES
         /// recheck if other species can adopt the orphans individuals.
         std::forward_list<std::reference_wrapper<Species<I, F>>> list_of_new_species;
-        for (std::unique_ptr<I> &orphan : generated_individuals.orphans) {
-            bool compatible_species_found = false;
-            for (Species<I, F> &species : generated_individuals.new_species_collection) {
-                if (species.is_compatible(*orphan)) {
-                    species.insert(std::move(orphan));
-                    compatible_species_found = true;
-                    break;
+        if (parallel) {
+            _adopt_orphans_parallel(generated_individuals.orphans, generated_individuals.new_species_collection,
+                                    local_next_species_id, executor);
+        } else {
+            for (std::unique_ptr<I> &orphan : generated_individuals.orphans) {
+                bool compatible_species_found = false;
+                for (Species<I, F> &species : generated_individuals.new_species_collection) {
+                    if (species.is_compatible(*orphan, compatibility_threshold)) {
+                        species.insert(std::move(orphan));
+                        compatible_species_found = true;
+                        break;
+                    }
+                }
+                if (!compatible_species_found
+                    && !_insert_in_nearest_species(generated_individuals.new_species_collection, orphan)) {
+                    Species<I, F> new_species = Species<I, F>(std::move(orphan), local_next_species_id);
+                    local_next_species_id++;
+                    generated_individuals.new_species_collection.add_species(std::move(new_species));
+                    // add an entry for new species which does not have a previous iteration.
+                    list_of_new_species.emplace_front(generated_individuals.new_species_collection.back());
                 }
-            }
-            if (!compatible_species_found) {
-                Species<I, F> new_species = Species<I, F>(std::move(orphan), local_next_species_id);
-                local_next_species_id++;
-                generated_individuals.new_species_collection.add_species(std::move(new_species));
-                // add an entry for new species which does not have a previous iteration.
-                list_of_new_species.emplace_front(generated_individuals.new_species_collection.back());
             }
         }
 
@@ -262,34 +588,34 @@ public:
         //////////////////////////////////////////////
         /// POPULATION MANAGEMENT
         /// update the species population, based ont he population management algorithm.
-        int species_i = 0;
+        /// The new species (after the old ones) keep the entire population.
+        std::vector<Species<I, F>*> managed_species;
         for (Species<I, F> &new_species : generated_individuals.new_species_collection) {
-            if (species_i > species_collection.size()) {
-                // Finished. The new species keep the entire population.
-                std::cout << "POPULATION MANAGEMENT Finished. The new species keep the entire population." << std::endl;
+            if (managed_species.size() >= species_collection.size())
                 break;
-            }
-            std::cout << "POPULATION MANAGEMENT " << species_i << std::endl;
+            managed_species.emplace_back(&new_species);
+        }
 
+        auto manage_species = [&](size_t species_i) {
+            Species<I, F> &new_species = *managed_species[species_i];
             std::vector<std::unique_ptr<I> > new_species_individuals(new_species.size());
             // this empties the new_species list
-            std::cout << "POPULATION MANAGEMENT " << species_i << " transform" << std::endl;
             std::transform(new_species.begin(), new_species.end(),
                            new_species_individuals.begin(),
                            [](typename Species<I, F>::Indiv &i) { return std::move(i.individual); });
 
-            std::cout << "POPULATION MANAGEMENT " << species_i << " lambda call" << std::endl;
             // Create next population
             std::vector<std::unique_ptr<I> > new_individuals
                     = population_management(std::move(new_species_individuals),
                                             generated_individuals.old_species_individuals[species_i],
-                                            offspring_amounts[species_i]);
+                                            offspring_amounts[species_i],
+                                            new_species.id());
 
             new_species.set_individuals(std::move(new_individuals));
+        };
 
-            std::cout << "POPULATION MANAGEMENT " << species_i << " done" << std::endl;
-            species_i++;
-        }
+        // every species is managed independently, the results go in their own species
+        executor.parallel_for(managed_species.size(), manage_species);
 
 
         //////////////////////////////////////////////
@@ -318,9 +644,245 @@ public:
 
         //////////////////////////////////////////////
         /// CREATE THE NEXT GENUS
-        return Genus(std::move(generated_individuals.new_species_collection), local_next_species_id);
+        return Genus(std::move(generated_individuals.new_species_collection), local_next_species_id,
+                     compatibility_threshold, max_species, _generation + 1);
     }
-private:
+
+    /**
+     * @param new_individual function generating the n-th offspring of a species
+     * @param executor executor generating the offspring, nullptr to generate them on the calling thread
+     */
+    GenusSeed<I,F> _generate_new_individuals(
+            const Conf &conf,
+            const std::function<std::unique_ptr<I>(const Species<I, F> &species, size_t n_offspring)> &new_individual,
+            Executor *executor
+    ) const
+    {
+        // Calculate offspring amount
+        std::vector<unsigned int> offspring_amounts = _count_offsprings(conf.total_population_size);
+
+        // Pointers to current const species_collection
+        std::vector<std::vector<const I*> > old_species_individuals;
+        std::vector<const Species<I, F>*> old_species;
+        std::vector<unsigned int> species_ids;
+        for (const Species<I, F> &species : species_collection) {
+            old_species_individuals.emplace_back(species.size());
+
+            // Get the individuals from the individual with adjusted fitness tuple list.
+            std::transform(species.cbegin(), species.cend(),
+                    old_species_individuals.back().begin(),
+                    [](const typename Species<I,F>::Indiv &i)
+                    { return i.individual.get(); });
+            old_species.emplace_back(&species);
+            species_ids.emplace_back(species.id());
+        }
+
+        //////////////////////////////////////////////
+        /// GENERATE NEW INDIVIDUALS
+        /// offspring of each species in generation order, with their compatibility with the species
+        std::vector<std::vector<std::pair<std::unique_ptr<I>, bool> > > species_offspring(old_species.size());
+        for (size_t species_i = 0; species_i < old_species.size(); species_i++)
+            species_offspring[species_i].resize(offspring_amounts[species_i]);
+
+        auto generate_offspring = [&](size_t species_i, size_t n_offspring) {
+            const Species<I, F> &species = *old_species[species_i];
+            std::unique_ptr<I> offspring = new_individual(species, n_offspring);
+
+            // if the new individual is compatible with the species, otherwise create new.
+            const bool compatible = species.is_compatible(*offspring, compatibility_threshold);
+            species_offspring[species_i][n_offspring] = std::make_pair(std::move(offspring), compatible);
+        };
+
+        std::vector<unsigned int> species_nodes;
+        if (executor != nullptr) {
+            // the species in parallel, each on its node, and nested the offspring of each species
+            species_nodes = executor->place_species(species_ids, offspring_amounts);
+            executor->parallel_for_nodes(species_nodes, [&](size_t species_i) {
+                executor->parallel_for(offspring_amounts[species_i], [&](size_t n_offspring) {
+                    generate_offspring(species_i, n_offspring);
+                });
+            });
+        } else {
+            for (size_t species_i = 0; species_i < old_species.size(); species_i++) {
+                for (size_t n_offspring = 0; n_offspring < offspring_amounts[species_i]; n_offspring++)
+                    generate_offspring(species_i, n_offspring);
+            }
+        }
+
+        // Clone Species
+        SpeciesCollection<I, F> new_species_collection;
+        std::vector<std::unique_ptr<I> > orphans;
+
+        // Pointers to values in new_species_collection and orphans
+        std::vector<I*> need_evaluation;
+        // Species index of each individual in need_evaluation, -1 for orphans
+        std::vector<int> evaluation_species;
+        // Node of the species that generated each individual in need_evaluation
+        std::vector<unsigned int> evaluation_nodes;
+
+        for (size_t species_i = 0; species_i < old_species.size(); species_i++) {
+            std::vector<std::unique_ptr<I> > new_individuals;
+            for (std::pair<std::unique_ptr<I>, bool> &offspring : species_offspring[species_i]) {
+                if (offspring.second) {
+                    new_individuals.emplace_back(std::move(offspring.first));
+                    need_evaluation.emplace_back(new_individuals.back().get());
+                    evaluation_species.emplace_back(static_cast<int>(species_i));
+                } else {
+                    orphans.emplace_back(std::move(offspring.first));
+                    need_evaluation.emplace_back(orphans.back().get());
+                    evaluation_species.emplace_back(-1);
+                }
+                if (executor != nullptr)
+                    evaluation_nodes.emplace_back(species_nodes[species_i]);
+            }
+
+            new_species_collection.add_species(
+                    old_species[species_i]->clone_with_new_individuals(std::move(new_individuals))
+                    );
+        }
+
+        GenusSeed<I,F> seed(
+                std::move(orphans),
+                std::move(new_species_collection),
+                std::move(need_evaluation),
+                std::move(old_species_individuals),
+                std::move(evaluation_species),
+                std::move(offspring_amounts));
+        seed.evaluation_nodes = std::move(evaluation_nodes);
+        return seed;
+    }
+
+    /**
+     * See `next_compatibility_threshold`
+     */
+    void _update_compatibility_threshold(const Conf &conf)
+    {
+        compatibility_threshold = next_compatibility_threshold(compatibility_threshold, species_collection.size(), conf);
+    }
+
+    /**
+     * If the species cap is reached, inserts the individual in the species with the nearest representative.
+     * @param collection the species
+     * @param individual individual not compatible with any species, it is moved only if inserted
+     * @return true if the individual was inserted
+     */
+    bool _insert_in_nearest_species(SpeciesCollection<I, F> &collection, std::unique_ptr<I> &individual) const
+    {
+        if (max_species == 0 || collection.size() < max_species)
+            return false;
+
+        const size_t nearest = speciation::nearest_species(collection.size(), [&collection](size_t s) -> const I* {
+            const Species<I, F> &species = *(collection.begin() + s);
+            return species.empty() ? nullptr : &species.representative();
+        }, *individual);
+        if (nearest == collection.size())
+            return false;
+
+        (collection.begin() + nearest)->insert(std::move(individual));
+        return true;
+    }
+
+    /**
+     * Batched version of the orphan adoption loop in `next_generation`, with the same result.
+     *
+     * Sequentially, every orphan goes in the first compatible species, old species first and then the species founded
+     * by the previous orphans, or it founds a new species. The representatives of the species never change, so:
+     * 1. the orphans are matched against the old species in parallel;
+     * 2. the remaining orphans are clustered with a leader clustering, in blocks: the orphans of a block are matched
+     *    in parallel against the leaders found in the previous blocks, then the unmatched ones are clustered
+     *    sequentially between themselves (or join the nearest species, when `max_species` is reached);
+     * 3. the orphans are moved in their species, in the original order.
+     */
+    void _adopt_orphans_parallel(std::vector<std::unique_ptr<I> > &orphans,
+                                 SpeciesCollection<I, F> &collection,
+                                 unsigned int &local_next_species_id,
+                                 Executor &executor) const
+    {
+        constexpr size_t NONE = std::numeric_limits<size_t>::max();
+        const size_t n_old_species = collection.size();
+
+        // 1. first compatible old species
+        std::vector<size_t> adopter(orphans.size(), NONE);
+        executor.parallel_for(orphans.size(), [&](size_t o) {
+            for (size_t s = 0; s < n_old_species; s++) {
+                if ((collection.begin() + s)->is_compatible(*orphans[o], compatibility_threshold)) {
+                    adopter[o] = s;
+                    break;
+                }
+            }
+        });
+
+        std::vector<size_t> unmatched;
+        for (size_t o = 0; o < orphans.size(); o++) {
+            if (adopter[o] == NONE) unmatched.emplace_back(o);
+        }
+
+        // 2. leader clustering of the remaining orphans
+        std::vector<size_t> leaders;
+        std::vector<size_t> leader_of(orphans.size(), NONE);
+        const size_t block_size = 16 * static_cast<size_t>(std::max(executor.concurrency(), 1u));
+        for (size_t block_begin = 0; block_begin < unmatched.size(); block_begin += block_size) {
+            const size_t block_end = std::min(block_begin + block_size, unmatched.size());
+            const size_t n_leaders = leaders.size();
+
+            executor.parallel_for(block_end - block_begin, [&](size_t k) {
+                const size_t o = unmatched[block_begin + k];
+                for (size_t l = 0; l < n_leaders; l++) {
+                    if (speciation::is_compatible(*orphans[leaders[l]], *orphans[o], compatibility_threshold)) {
+                        leader_of[o] = l;
+                        break;
+                    }
+                }
+            });
+
+            for (size_t k = block_begin; k < block_end; k++) {
+                const size_t o = unmatched[k];
+                if (leader_of[o] != NONE) continue;
+                for (size_t l = n_leaders; l < leaders.size(); l++) {
+                    if (speciation::is_compatible(*orphans[leaders[l]], *orphans[o], compatibility_threshold)) {
+                        leader_of[o] = l;
+                        break;
+                    }
+                }
+                if (leader_of[o] != NONE) continue;
+
+                // species cap reached: nearest old species or leader
+                const size_t n_species = n_old_species + leaders.size();
+                if (max_species > 0 && n_species >= max_species) {
+                    const size_t nearest = speciation::nearest_species(n_species, [&](size_t s) -> const I* {
+                        if (s >= n_old_species) return orphans[leaders[s - n_old_species]].get();
+                        const Species<I, F> &species = *(collection.begin() + s);
+                        return species.empty() ? nullptr : &species.representative();
+                    }, *orphans[o]);
+                    if (nearest < n_old_species) {
+                        adopter[o] = nearest;
+                        continue;
+                    } else if (nearest < n_species) {
+                        leader_of[o] = nearest - n_old_species;
+                        continue;
+                    }
+                }
+
+                leader_of[o] = leaders.size();
+                leaders.emplace_back(o);
+            }
+        }
+
+        // 3. move the orphans in their species
+        std::vector<size_t> leader_species;
+        for (size_t o = 0; o < orphans.size(); o++) {
+            if (adopter[o] != NONE) {
+                (collection.begin() + adopter[o])->insert(std::move(orphans[o]));
+            } else if (leaders[leader_of[o]] == o) {
+                leader_species.emplace_back(collection.size());
+                collection.add_species(Species<I, F>(std::move(orphans[o]), local_next_species_id));
+                local_next_species_id++;
+            } else {
+                (collection.begin() + leader_species[leader_of[o]])->insert(std::move(orphans[o]));
+            }
+        }
+    }
+
     /**
      * Generate a new individual from randomly selected parents + mutation
      *
@@ -368,8 +930,9 @@ private:
     }
 
     /**
-     * Calculates the number of offsprings allocated for each individual.
-     * The total of allocated individuals will be `number_of_individuals`
+     * Calculates the number of offsprings allocated for each species, proportionally to the sum of the adjusted
+     * fitnesses of its individuals (see `largest_remainder_apportionment`). Ties go to the best species.
+     * The total of allocated individuals is always exactly `number_of_individuals`.
      *
      * @param number_of_individuals Total number of individuals to generate
      * @return a vector of integers representing the number of allocated individuals for each species.
@@ -379,134 +942,38 @@ private:
     {
         assert(number_of_individuals > 0);
 
-        F average_adjusted_fitness = _calculate_average_fitness();
-
-        std::vector<unsigned int> species_offspring_amount =
-                _calculate_population_size(average_adjusted_fitness);
-
-        unsigned int offspring_amount_sum =
-                std::accumulate(species_offspring_amount.begin(), species_offspring_amount.end(), 0u);
-        unsigned int missing_offsprings = number_of_individuals - offspring_amount_sum;
-
-        if (missing_offsprings != 0) {
-            _correct_population_size(species_offspring_amount, missing_offsprings);
-            offspring_amount_sum =
-                    std::accumulate(species_offspring_amount.begin(), species_offspring_amount.end(), 0u);
-
-            if (offspring_amount_sum != number_of_individuals) {
-                std::stringstream error_message;
-                error_message << "Generated species_offspring_amount (sum = " << offspring_amount_sum << ") "
-                                 "does not equal number_of_individuals (" << number_of_individuals << ").\n";
-                throw std::runtime_error(error_message.str());
-            }
-        }
-
-        return species_offspring_amount;
-    }
-
-    /**
-     * Calculates the Average fitness of the population based on the adjusted fitnesses
-     * @return the average fitness
-     */
-    [[nodiscard]] F _calculate_average_fitness() const
-    {
-        // Calculate the total adjusted fitness
-        F total_adjusted_fitness = 0;
-        unsigned int number_of_individuals = 0;
+        std::vector<double> species_adjusted_fitness;
+        std::vector<F> species_best_fitness;
+        species_adjusted_fitness.reserve(species_collection.size());
+        species_best_fitness.reserve(species_collection.size());
         for (const Species<I,F> &species : species_collection) {
+            double adjusted_fitness_sum = 0.;
             for (const typename Species<I,F>::Indiv &indiv : species) {
                 assert(indiv.adjusted_fitness.has_value());
-                F adjusted_fitness = indiv.adjusted_fitness.value();
-                total_adjusted_fitness += adjusted_fitness;
-                number_of_individuals++;
+                adjusted_fitness_sum += static_cast<double>(indiv.adjusted_fitness.value());
             }
+            species_adjusted_fitness.emplace_back(adjusted_fitness_sum);
+            species_best_fitness.emplace_back(species.get_best_fitness().value_or(-std::numeric_limits<F>::infinity()));
         }
-        assert(total_adjusted_fitness > 0);
-
-        // Calculate the average adjusted fitness
-        F average_adjusted_fitness = total_adjusted_fitness / static_cast<F>(number_of_individuals);
-
-        return average_adjusted_fitness;
-    }
-
-    /**
-     * Calculates the number of offsprings allocated for each individual given the `average_adjusted_fitness`.
-     * The function is rounding real numbers to integer numbers, so the returned vector quite possibly will not sum up
-     * to the total population size.
-     *
-     * @param average_adjusted_fitness The average adjusted fitness across all the species.
-     * @return a vector of integers representing the number of allocated individuals for each species.
-     * The index of this list corresponds to the same index in `this->_species_list`.
-     */
-    [[nodiscard]] std::vector<unsigned int> _calculate_population_size(F average_adjusted_fitness) const
-    {
-        std::vector<unsigned int> species_offspring_amount;
-
-        for (const Species<I,F> &species: species_collection) {
-            double offspring_amount = 0.;
-            for (const typename Species<I,F>::Indiv &indiv : species) {
-                assert(indiv.adjusted_fitness.has_value());
-                offspring_amount += indiv.adjusted_fitness.value() / average_adjusted_fitness;
-            }
-            species_offspring_amount.emplace_back(std::lround(offspring_amount));
-        }
-
-        return species_offspring_amount;
-    }
 
-    /**
-     * `species_offspring_amount` could be incorrect because of approximation errors when we round floats to integers.
-     *
-     * This method modifies the `species_offspring_amount` so that the sum of the vector is equal to the total population size.
-     * It adds (or removes if negative) the `missing_offspring` number of individuals in the vector.
-     * When adding, it chooses the best species.
-     * When removing, it chooses the worst species, multiple species if one species is not big enough.
-     *
-     * @param species_offspring_amount vector of offspring_amounts that needs correction
-     * @param missing_offspring amount of correction to be done. Positive means we need more offsprings, negative means
-     * we have to much.
-     */
-    void _correct_population_size(
-            std::vector<unsigned int> &species_offspring_amount,
-            const int missing_offspring) const
-    {
-        // positive means lacking individuals
-        if (missing_offspring > 0)
-        {
-            size_t i = std::distance(species_collection.begin(), species_collection.get_best());
-            species_offspring_amount[i] += missing_offspring;
+        // apportion from the best to the worst species: on equal remainders, the best species gets the seat
+        std::vector<size_t> species_order(species_adjusted_fitness.size());
+        std::iota(species_order.begin(), species_order.end(), 0);
+        std::stable_sort(species_order.begin(), species_order.end(), [&species_best_fitness](size_t a, size_t b) {
+            return species_best_fitness[a] > species_best_fitness[b];
+        });
+        std::vector<double> ordered_adjusted_fitness(species_order.size());
+        for (size_t i = 0; i < species_order.size(); i++) {
+            ordered_adjusted_fitness[i] = species_adjusted_fitness[species_order[i]];
         }
-        // negative have excess individuals
-        else if (missing_offspring < 0)
-        {
-            // remove missing number of individuals
-            int excess_offspring = -missing_offspring;
-            std::set<unsigned int> excluded_id_list;
-
-            while (excess_offspring > 0) {
-                typename std::vector<Species<I, F> >::const_iterator worst_species =
-                        species_collection.get_worst(1, excluded_id_list);
-                size_t worst_species_i = std::distance(species_collection.begin(), worst_species);
-                int current_amount = species_offspring_amount[worst_species_i];
-
-                if (current_amount > excess_offspring) {
-                    current_amount -= excess_offspring;
-                    excess_offspring = 0;
-                } else {
-                    excess_offspring -= current_amount;
-                    current_amount = 0;
-                }
 
-                species_offspring_amount[worst_species_i] = current_amount;
-                excluded_id_list.insert(worst_species->id());
-            }
-
-            assert(excess_offspring == 0);
-        }
-        else
-        {
-            std::clog << "missing_offspring == 0, why did you call _correct_population_size()?" << std::endl;
+        const std::vector<unsigned int> ordered_amounts =
+                largest_remainder_apportionment(ordered_adjusted_fitness, number_of_individuals);
+        std::vector<unsigned int> species_offspring_amount(species_order.size());
+        for (size_t i = 0; i < species_order.size(); i++) {
+            species_offspring_amount[species_order[i]] = ordered_amounts[i];
         }
+        return species_offspring_amount;
     }
 
 public:
@@ -531,6 +998,21 @@ public:
         return species_collection.count_individuals();
     }
 
+    /**
+     * Current compatibility threshold, passed to the individuals that support it.
+     * @return the compatibility threshold
+     */
+    [[nodiscard]] double get_compatibility_threshold() const {
+        return compatibility_threshold;
+    }
+
+    /**
+     * The species of this genus, in order
+     */
+    [[nodiscard]] const SpeciesCollection<I,F>& get_species_collection() const {
+        return species_collection;
+    }
+
     //TODO iter_individuals
 
 };
@@ -6,7 +6,11 @@
 #define SPECIATION_GENUSSEED_H
 
 #include "SpeciesCollection.h"
+#include "Executor.h"
 
+#include <functional>
+#include <optional>
+#include <queue>
 #include <vector>
 #include <memory>
 
@@ -23,6 +27,13 @@ private:
     SpeciesCollection<I, F> new_species_collection;
     std::vector<I*> need_evaluation;
     const std::vector<std::vector<const I*> > old_species_individuals;
+    /// Species index of each individual in `need_evaluation`, -1 for orphans
+    const std::vector<int> evaluation_species;
+    /// Population size of each species after population management
+    const std::vector<unsigned int> target_populations;
+    /// Node of each individual in `need_evaluation` (see `Executor::place_species`), empty if not generated with an
+    /// executor
+    std::vector<unsigned int> evaluation_nodes;
 public:
 
     typename std::vector<I*>::iterator begin()
@@ -47,16 +58,104 @@ public:
         }
     }
 
+    /**
+     * Evaluates the new individuals in parallel, with `executor`.
+     * Each one is evaluated on the node where it was generated, e.g. its NUMA node with a `NumaExecutor`
+     * (see `Genus::generate_new_individuals` with an executor).
+     * @param evaluate_individual function evaluating an individual, it must be thread safe
+     * @param executor executor running the evaluations
+     */
+    void evaluate(const std::function<F(I*)> &evaluate_individual, Executor &executor)
+    {
+        auto evaluate_i = [this, &evaluate_individual](size_t i) {
+            I *new_individual = need_evaluation[i];
+            F fitness = evaluate_individual(new_individual);
+            std::optional<F> individual_fitness = new_individual->fitness();
+            assert(individual_fitness.has_value());
+            assert(fitness == individual_fitness.value());
+            (void) fitness;
+            (void) individual_fitness;
+        };
+
+        if (evaluation_nodes.size() == need_evaluation.size()) {
+            executor.parallel_for_nodes(evaluation_nodes, evaluate_i);
+        } else {
+            executor.parallel_for(need_evaluation.size(), evaluate_i);
+        }
+    }
+
+    /**
+     * Evaluates the new individuals, passing to the evaluator a cutoff: the fitness a new individual has to beat to be
+     * among the best of its species, as many as the species population after population management.
+     *
+     * Evaluators computing the fitness incrementally (e.g. cumulative reward over a simulation) can stop as soon as
+     * their upper bound falls below the cutoff, and report the bound as fitness.
+     * The cutoff tightens as the new individuals of the species are evaluated. It is std::nullopt when every
+     * individual can still survive, and always for orphans, which can found a new species.
+     * The cutoff is exact for plus-selection (old and new individuals competing together) population management,
+     * otherwise it is only a hint.
+     *
+     * @param evaluate_individual function evaluating an individual, with the same contract as in `evaluate()`
+     */
+    void evaluate_with_cutoff(const std::function<F(I*, const std::optional<F> &cutoff)> &evaluate_individual)
+    {
+        // best fitnesses of each species, the worst one on top
+        typedef std::priority_queue<F, std::vector<F>, std::greater<F> > BestFitnesses;
+        std::vector<BestFitnesses> species_best(target_populations.size());
+
+        auto push_fitness = [this, &species_best](size_t species, F fitness) {
+            BestFitnesses &best = species_best[species];
+            if (best.size() < target_populations[species]) {
+                best.push(fitness);
+            } else if (!best.empty() && best.top() < fitness) {
+                best.pop();
+                best.push(fitness);
+            }
+        };
+
+        for (size_t species = 0; species < old_species_individuals.size(); species++) {
+            for (const I *old_individual : old_species_individuals[species]) {
+                std::optional<F> old_fitness = old_individual->fitness();
+                if (old_fitness.has_value())
+                    push_fitness(species, old_fitness.value());
+            }
+        }
+
+        for (size_t i = 0; i < need_evaluation.size(); i++) {
+            I *new_individual = need_evaluation[i];
+            const int species = evaluation_species[i];
+
+            std::optional<F> cutoff;
+            if (species >= 0 && !species_best[species].empty()
+                && species_best[species].size() == target_populations[species]) {
+                cutoff = species_best[species].top();
+            }
+
+            F fitness = evaluate_individual(new_individual, cutoff);
+            std::optional<F> individual_fitness = new_individual->fitness();
+            assert(individual_fitness.has_value());
+            assert(fitness == individual_fitness.value());
+            (void) individual_fitness;
+
+            if (species >= 0)
+                push_fitness(species, fitness);
+        }
+    }
+
 private:
     GenusSeed(std::vector<std::unique_ptr<I> > &&orphans,
               SpeciesCollection<I, F> &&new_species_collection,
               std::vector<I *> &&need_evaluation,
-              const std::vector<std::vector<const I*> > &&old_species_individuals
+              const std::vector<std::vector<const I*> > &&old_species_individuals,
+              std::vector<int> &&evaluation_species,
+              std::vector<unsigned int> &&target_populations
     )
             : orphans(std::move(orphans))
             , new_species_collection(std::move(new_species_collection))
             , need_evaluation(std::move(need_evaluation))
             , old_species_individuals(std::move(old_species_individuals))
+            , evaluation_species(std::move(evaluation_species))
+            , target_populations(std::move(target_populations))
     {}
 };
 
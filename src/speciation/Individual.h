@@ -6,6 +6,15 @@
 #define SPECIATION_INDIVIDUAL_H
 
 #include <optional>
+#include <type_traits>
+#include <utility>
+
+#if defined(__cpp_concepts) && __cpp_concepts >= 201907L && defined(__has_include)
+#if __has_include(<concepts>)
+#include <concepts>
+#define SPECIATION_HAS_CONCEPTS 1
+#endif
+#endif
 
 namespace speciation {
 
@@ -35,6 +44,16 @@ public:
     /**
      * Tests if the this individual is compatible with another individual.
      * Compatibility means that two individuals can fit in the same species.
+     *
+     * Individuals can also implement `bool is_compatible(const Individual &other, double threshold) const`:
+     * the Genus then uses it, with the (possibly adaptive) threshold from `Conf::compatibility_threshold`.
+     * To use `Conf::max_species`, individuals must implement `double distance(const Individual &other) const` too.
+     *
+     * Expensive compatibility checks can be prefiltered with a sketch: a small signature of the genome, computed once
+     * and stored by the individual, returned by `const S& sketch() const`. `S` implements
+     * `bool may_be_compatible(const S &other) const` (or `(const S &other, double threshold)`), which must return
+     * true for every compatible pair: `is_compatible` is skipped when it's false. Species keep the sketch of their
+     * representative inline.
      * @param other
      * @return true if the two individuals are compatible.
      */
@@ -44,10 +63,88 @@ public:
      * Creates a deep copy of the current individual into a new one.
      * Used in the steady state algorithm when an individual is passed as-is in the new generation.
      * It's also used when using multiple_selection_*. Because the source of multiple_selection is const.
+     * To share large individuals between generations instead of copying them, see `SharedIndividual`.
      * @return A deep copy of `this` individual.
      */
     [[nodiscard]] virtual Individual clone() const = 0;
 };
+
+namespace detail {
+template<typename I, typename F, typename = void>
+struct has_fitness : std::false_type {};
+template<typename I, typename F>
+struct has_fitness<I, F, std::enable_if_t<std::is_same<
+        decltype(std::declval<const I&>().fitness()), std::optional<F> >::value> > : std::true_type {};
+
+template<typename I, typename = void>
+struct has_is_compatible : std::false_type {};
+template<typename I>
+struct has_is_compatible<I, std::enable_if_t<std::is_convertible<
+        decltype(std::declval<const I&>().is_compatible(std::declval<const I&>())), bool>::value> > : std::true_type {};
+
+template<typename I, typename = void>
+struct has_clone : std::false_type {};
+template<typename I>
+struct has_clone<I, std::enable_if_t<std::is_same<
+        decltype(std::declval<const I&>().clone()), I>::value> > : std::true_type {};
+}
+
+/**
+ * True if `I` implements the interface of `IndividualPrototype<F, I>` (fitness, is_compatible and clone),
+ * with or without inheriting from it.
+ */
+template<typename I, typename F>
+struct is_individual : std::integral_constant<bool,
+        detail::has_fitness<I, F>::value && detail::has_is_compatible<I>::value && detail::has_clone<I>::value> {};
+
+template<typename I, typename F>
+inline constexpr bool is_individual_v = is_individual<I, F>::value;
+
+#ifdef SPECIATION_HAS_CONCEPTS
+/**
+ * The interface of `IndividualPrototype<F, I>` as a C++20 concept.
+ */
+template<typename I, typename F>
+concept IndividualConcept = requires(const I &a, const I &b) {
+    { a.fitness() } -> std::same_as<std::optional<F> >;
+    { a.is_compatible(b) } -> std::convertible_to<bool>;
+    { a.clone() } -> std::same_as<I>;
+};
+#endif
+
+/**
+ * Same contract as `IndividualPrototype`, without virtual functions (CRTP).
+ *
+ * The functions are non-virtual members of `Individual`, so the calls in the hot loops (selection comparators,
+ * best individual, speciation) are dispatched statically and can be inlined.
+ * The interface is checked at compile time, when the individual type is complete.
+ *
+ * @tparam F fitness type, it must have a negative infinity value.
+ * @tparam Individual the child individual class, implementing
+ * `std::optional<F> fitness() const`, `bool is_compatible(const Individual &other) const` and
+ * `Individual clone() const`.
+ */
+template<typename F, typename Individual>
+class StaticIndividualPrototype {
+protected:
+    StaticIndividualPrototype() = default;
+
+    // instantiated with the destructor of Individual, when it's a complete type
+    ~StaticIndividualPrototype()
+    {
+        static_assert(detail::has_fitness<Individual, F>::value,
+                      "Individual must implement `std::optional<F> fitness() const`");
+        static_assert(detail::has_is_compatible<Individual>::value,
+                      "Individual must implement `bool is_compatible(const Individual &other) const`");
+        static_assert(detail::has_clone<Individual>::value,
+                      "Individual must implement `Individual clone() const`");
+    }
+
+    StaticIndividualPrototype(const StaticIndividualPrototype &) = default;
+    StaticIndividualPrototype(StaticIndividualPrototype &&) noexcept = default;
+    StaticIndividualPrototype& operator=(const StaticIndividualPrototype &) = default;
+    StaticIndividualPrototype& operator=(StaticIndividualPrototype &&) noexcept = default;
+};
 }
 
 #endif //SPECIATION_INDIVIDUAL_H
@@ -0,0 +1,239 @@
+#ifndef SPECIATION_ISLANDMODEL_H
+#define SPECIATION_ISLANDMODEL_H
+
+#include "Genus.h"
+#include "BoundedQueue.h"
+#include "Random.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace speciation {
+
+/**
+ * Configuration of the island model
+ */
+struct IslandConf {
+    enum class Topology {
+        /// island i sends its migrants to island i+1
+        Ring,
+        /// every migrant is sent to a random island (never the source island)
+        Random,
+    };
+
+    /// Every how many generations the migration happens
+    unsigned int migration_interval = 10;
+    /// How many of the best individuals of an island migrate
+    unsigned int migrants = 1;
+    /// Where the migrants are sent
+    Topology topology = Topology::Ring;
+    /// If true, all islands wait for each other after every migration
+    bool synchronous = false;
+    /// Capacity of the incoming migrants queue of every island. Migrants are dropped when it is full.
+    size_t queue_capacity = 64;
+    /// Seed for the random topology
+    uint64_t seed = 0;
+};
+
+/**
+ * Island model: evolves multiple `Genus` in parallel, one thread per island,
+ * exchanging the best individuals every `IslandConf::migration_interval` generations.
+ *
+ * Migrants are cloned, sent through lock-free bounded queues and inserted in the destination island with
+ * `Genus::insert_individual()`, so they join a compatible species or found a new one, like orphans do.
+ * Islands never wait for each other, unless `IslandConf::synchronous` is set.
+ *
+ * @tparam I individual type, it must provide `I clone() const`
+ * @tparam F fitness type
+ */
+template<typename I, typename F>
+class IslandModel {
+public:
+    /**
+     * Function that advances the genus of one island by one generation (e.g. update, generate_new_individuals,
+     * evaluate and next_generation). It's called concurrently from different threads, one per island,
+     * so it must not share unprotected state between islands (e.g. use one random generator per island).
+     *
+     * Parameters are: the genus to advance, index of the island and the generation number (starting from 1).
+     * Immigrants are inserted before the call, so their adjusted fitness is computed by `Genus::update()`.
+     */
+    using Step = std::function<void(Genus<I, F> &genus, size_t island, unsigned int generation)>;
+
+private:
+    /// Simple reusable barrier that can be broken, to not deadlock when an island fails
+    class Barrier {
+        std::mutex mutex;
+        std::condition_variable cv;
+        const size_t count;
+        size_t waiting = 0;
+        size_t phase = 0;
+        bool broken = false;
+    public:
+        explicit Barrier(size_t count) : count(count) {}
+
+        /// @return false if the barrier has been broken
+        bool arrive_and_wait()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (broken) return false;
+            const size_t current_phase = phase;
+            if (++waiting == count) {
+                waiting = 0;
+                phase++;
+                cv.notify_all();
+                return true;
+            }
+            cv.wait(lock, [&] { return phase != current_phase || broken; });
+            return !broken;
+        }
+
+        void break_barrier()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            broken = true;
+            cv.notify_all();
+        }
+    };
+
+    std::vector<Genus<I, F> > islands;
+    std::vector<std::unique_ptr<BoundedQueue<std::unique_ptr<I> > > > inboxes;
+    IslandConf conf;
+
+    std::atomic<size_t> _sent_migrants;
+    std::atomic<size_t> _dropped_migrants;
+
+public:
+    /**
+     * @param islands initial (already speciated and evaluated) genus of each island
+     * @param conf island model configuration
+     */
+    IslandModel(std::vector<Genus<I, F> > &&islands, IslandConf conf)
+            : islands(std::move(islands))
+            , conf(conf)
+            , _sent_migrants(0)
+            , _dropped_migrants(0)
+    {
+        if (this->islands.empty())
+            throw std::invalid_argument("Island model needs at least one island");
+        if (conf.migration_interval == 0)
+            throw std::invalid_argument("Migration interval must be greater than zero");
+        for (size_t i = 0; i < this->islands.size(); i++) {
+            inboxes.emplace_back(std::make_unique<BoundedQueue<std::unique_ptr<I> > >(conf.queue_capacity));
+        }
+    }
+
+    /**
+     * Runs `generations` generations on every island, in parallel.
+     * If any island throws, the other islands stop at their next generation and the first exception is rethrown.
+     *
+     * @param generations number of generations to run
+     * @param step function that advances an island by one generation
+     */
+    void run(unsigned int generations, const Step &step)
+    {
+        const size_t n_islands = islands.size();
+        Barrier barrier(n_islands);
+        std::atomic<bool> stop(false);
+        std::vector<std::exception_ptr> errors(n_islands);
+
+        auto island_loop = [&](size_t island_i) {
+            try {
+                Genus<I, F> &genus = islands[island_i];
+                Philox4x32 topology_random = Philox4x32(conf.seed).split(island_i);
+
+                for (unsigned int generation = 1; generation <= generations && !stop; generation++) {
+                    _receive_migrants(island_i);
+
+                    step(genus, island_i, generation);
+
+                    if (generation % conf.migration_interval == 0) {
+                        _send_migrants(island_i, topology_random);
+                        if (conf.synchronous && !barrier.arrive_and_wait())
+                            break;
+                    }
+                }
+            } catch (...) {
+                errors[island_i] = std::current_exception();
+                stop = true;
+                barrier.break_barrier();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(n_islands);
+        for (size_t i = 0; i < n_islands; i++) {
+            threads.emplace_back(island_loop, i);
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+
+        for (std::exception_ptr &error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+    }
+
+private:
+    void _receive_migrants(size_t island_i)
+    {
+        std::unique_ptr<I> migrant;
+        while (inboxes[island_i]->try_pop(migrant)) {
+            islands[island_i].insert_individual(std::move(migrant));
+        }
+    }
+
+    void _send_migrants(size_t island_i, Philox4x32 &random)
+    {
+        const size_t n_islands = islands.size();
+        if (n_islands < 2 || conf.migrants == 0)
+            return;
+
+        for (const I *best : islands[island_i].best_individuals(conf.migrants)) {
+            size_t destination;
+            if (conf.topology == IslandConf::Topology::Ring) {
+                destination = (island_i + 1) % n_islands;
+            } else {
+                // random island, excluding the source
+                destination = bounded_rand(random, n_islands - 1);
+                if (destination >= island_i) destination++;
+            }
+
+            std::unique_ptr<I> migrant = std::make_unique<I>(best->clone());
+            if (inboxes[destination]->try_push(std::move(migrant))) {
+                _sent_migrants++;
+            } else {
+                _dropped_migrants++;
+            }
+        }
+    }
+
+public:
+    // Relay functions
+    [[nodiscard]] size_t size() const {
+        return islands.size();
+    }
+    Genus<I, F>& island(size_t i) {
+        return islands.at(i);
+    }
+    const Genus<I, F>& island(size_t i) const {
+        return islands.at(i);
+    }
+    /// Number of migrants delivered to another island queue
+    [[nodiscard]] size_t sent_migrants() const {
+        return _sent_migrants;
+    }
+    /// Number of migrants dropped because the destination queue was full
+    [[nodiscard]] size_t dropped_migrants() const {
+        return _dropped_migrants;
+    }
+};
+
+}
+
+#endif //SPECIATION_ISLANDMODEL_H
@@ -0,0 +1,312 @@
+#ifndef SPECIATION_MULTIOBJECTIVE_H
+#define SPECIATION_MULTIOBJECTIVE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+namespace speciation {
+
+/**
+ * Objective values of an individual, all maximized
+ */
+using Objectives = std::vector<double>;
+
+/**
+ * @return true if `a` Pareto-dominates `b`: not worse in any objective and better in at least one (maximizing)
+ */
+inline bool dominates(const Objectives &a, const Objectives &b)
+{
+    assert(a.size() == b.size());
+    bool better = false;
+    for (size_t m = 0; m < a.size(); m++) {
+        if (a[m] < b[m]) return false;
+        if (a[m] > b[m]) better = true;
+    }
+    return better;
+}
+
+namespace detail {
+
+/**
+ * Set of points answering "is there a point dominating q?", used for the fronts of `non_dominated_sort`.
+ *
+ * Logarithmic method (Bentley-Saxe) over static k-d trees: the points are in trees of 1, 2, 4, ... points, an
+ * insertion merges the smaller trees in a new one. Every node stores the componentwise maximum of its subtree, and
+ * a subtree is skipped when its maximum does not dominate q, so a query visits few nodes also in fronts with tens of
+ * thousands of points.
+ */
+class DominanceIndex {
+    const std::vector<Objectives> *points;
+    size_t n_objectives;
+
+    struct Tree {
+        /// Point indices, the root of a range is at its middle
+        std::vector<size_t> nodes;
+        /// Maximum of the subtree of each node, n_objectives values per node
+        std::vector<double> maximum;
+    };
+    /// trees[i] is empty or holds 2^i points
+    std::vector<Tree> trees;
+
+public:
+    DominanceIndex(const std::vector<Objectives> &points, size_t n_objectives)
+            : points(&points)
+            , n_objectives(n_objectives)
+    {}
+
+    void insert(size_t p)
+    {
+        std::vector<size_t> merged = {p};
+        size_t level = 0;
+        for (; level < trees.size() && !trees[level].nodes.empty(); level++) {
+            merged.insert(merged.end(), trees[level].nodes.begin(), trees[level].nodes.end());
+            trees[level] = Tree();
+        }
+        if (level == trees.size()) trees.emplace_back();
+
+        Tree &tree = trees[level];
+        tree.nodes = std::move(merged);
+        tree.maximum.resize(tree.nodes.size() * n_objectives);
+        _build(tree, 0, tree.nodes.size(), 0);
+    }
+
+    /// @return true if a point of the set dominates `q`
+    [[nodiscard]] bool dominates(const Objectives &q) const
+    {
+        // the smaller trees have the most recent points, the closest to q in the sort order
+        for (const Tree &tree : trees) {
+            if (_dominates(tree, 0, tree.nodes.size(), q)) return true;
+        }
+        return false;
+    }
+
+private:
+    /// Splitting objective at a depth. Objective 0 is skipped: in `non_dominated_sort` it never discriminates.
+    size_t _split(size_t depth) const
+    {
+        return n_objectives > 1 ? 1 + depth % (n_objectives - 1) : 0;
+    }
+
+    void _build(Tree &tree, size_t begin, size_t end, size_t depth)
+    {
+        if (begin >= end) return;
+        const size_t middle = begin + (end - begin) / 2;
+        const size_t objective = _split(depth);
+        const std::vector<Objectives> &p = *points;
+        std::nth_element(tree.nodes.begin() + begin, tree.nodes.begin() + middle, tree.nodes.begin() + end,
+                         [&p, objective](size_t a, size_t b) { return p[a][objective] < p[b][objective]; });
+        _build(tree, begin, middle, depth + 1);
+        _build(tree, middle + 1, end, depth + 1);
+
+        double *maximum = &tree.maximum[middle * n_objectives];
+        std::copy(p[tree.nodes[middle]].begin(), p[tree.nodes[middle]].end(), maximum);
+        for (size_t child : {begin + (middle - begin) / 2, middle + 1 + (end - middle - 1) / 2}) {
+            if (child < begin || child >= end || child == middle) continue;
+            const double *child_maximum = &tree.maximum[child * n_objectives];
+            for (size_t m = 0; m < n_objectives; m++)
+                maximum[m] = std::max(maximum[m], child_maximum[m]);
+        }
+    }
+
+    bool _dominates(const Tree &tree, size_t begin, size_t end, const Objectives &q) const
+    {
+        if (begin >= end) return false;
+        const size_t middle = begin + (end - begin) / 2;
+        const double *maximum = &tree.maximum[middle * n_objectives];
+        for (size_t m = 0; m < n_objectives; m++) {
+            if (maximum[m] < q[m]) return false;
+        }
+        if (speciation::dominates((*points)[tree.nodes[middle]], q)) return true;
+        // the upper half first, it holds the points most likely to dominate q
+        return _dominates(tree, middle + 1, end, q) || _dominates(tree, begin, middle, q);
+    }
+};
+
+}
+
+/**
+ * Non-dominated sorting with the Efficient Non-dominated Sort, binary search strategy (ENS-BS).
+ * Zhang et al. "An Efficient Approach to Nondominated Sorting for Evolutionary Multiobjective Optimization" (2015)
+ *
+ * The points are sorted lexicographically, so that a point can only be dominated by the points before it, then each
+ * point is placed with a binary search over the fronts found so far. Instead of scanning the members of a front, the
+ * binary search queries a `detail::DominanceIndex` of the front: the sort takes about O(MN log^2 N) also with very
+ * large fronts (the usual case in a converging population), against the O(MN^2) of the NSGA-II fast
+ * non-dominated sort.
+ *
+ * @param points objectives of each point, all with the same number of objectives (maximized)
+ * @return front of each point, in the same order: 0 for the non-dominated points, 1 for the points dominated only by
+ * front 0 and so on. Identical points are in the same front.
+ */
+inline std::vector<unsigned int> non_dominated_sort(const std::vector<Objectives> &points)
+{
+    std::vector<size_t> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&points](size_t a, size_t b) {
+        // lexicographically decreasing, ties by index
+        for (size_t m = 0; m < points[a].size(); m++) {
+            if (points[a][m] != points[b][m]) return points[a][m] > points[b][m];
+        }
+        return a < b;
+    });
+
+    const size_t n_objectives = points.empty() ? 0 : points[0].size();
+    std::vector<unsigned int> ranks(points.size(), 0);
+    std::vector<detail::DominanceIndex> fronts;
+    for (size_t p : order) {
+        // if a point of front k dominates p, a point of every front before k dominates it too
+        size_t low = 0;
+        size_t high = fronts.size();
+        while (low < high) {
+            const size_t middle = low + (high - low) / 2;
+            if (fronts[middle].dominates(points[p])) low = middle + 1;
+            else high = middle;
+        }
+        if (low == fronts.size()) fronts.emplace_back(points, n_objectives);
+        fronts[low].insert(p);
+        ranks[p] = static_cast<unsigned int>(low);
+    }
+    return ranks;
+}
+
+/**
+ * NSGA-II crowding distance of each point in its front: the sum over the objectives of the normalized distance
+ * between its two neighbours. The extremes of each front have an infinite distance.
+ *
+ * @param points objectives of each point
+ * @param ranks front of each point, see `non_dominated_sort`
+ * @return crowding distance of each point, in the same order
+ */
+inline std::vector<double> crowding_distance(const std::vector<Objectives> &points,
+                                             const std::vector<unsigned int> &ranks)
+{
+    assert(points.size() == ranks.size());
+    std::vector<double> distances(points.size(), 0.);
+    if (points.empty()) return distances;
+
+    const unsigned int n_fronts = *std::max_element(ranks.begin(), ranks.end()) + 1;
+    std::vector<std::vector<size_t> > fronts(n_fronts);
+    for (size_t p = 0; p < points.size(); p++)
+        fronts[ranks[p]].emplace_back(p);
+
+    const size_t n_objectives = points[0].size();
+    for (std::vector<size_t> &front : fronts) {
+        if (front.size() <= 2) {
+            for (size_t p : front) distances[p] = std::numeric_limits<double>::infinity();
+            continue;
+        }
+        for (size_t m = 0; m < n_objectives; m++) {
+            std::sort(front.begin(), front.end(), [&points, m](size_t a, size_t b) {
+                return points[a][m] < points[b][m] || (points[a][m] == points[b][m] && a < b);
+            });
+            const double range = points[front.back()][m] - points[front.front()][m];
+            distances[front.front()] = std::numeric_limits<double>::infinity();
+            distances[front.back()] = std::numeric_limits<double>::infinity();
+            if (!(range > 0.)) continue;
+            for (size_t i = 1; i + 1 < front.size(); i++)
+                distances[front[i]] += (points[front[i + 1]][m] - points[front[i - 1]][m]) / range;
+        }
+    }
+    return distances;
+}
+
+/**
+ * Scalar fitness for a multi-objective point, so that the species (adjusted fitness, offspring allocation) and the
+ * scalar selections keep working: better fronts get a higher fitness, and inside a front the less crowded points.
+ *
+ * The fitness is `n_fronts - rank` plus a crowding bonus in [0, 0.5], always positive.
+ *
+ * @param rank front of the point
+ * @param crowding crowding distance of the point
+ * @param n_fronts number of fronts
+ */
+template<typename F>
+inline F pareto_fitness(unsigned int rank, double crowding, unsigned int n_fronts)
+{
+    assert(rank < n_fronts);
+    const double bonus = std::isinf(crowding) ? 0.5 : 0.5 * crowding / (1. + crowding);
+    return static_cast<F>(static_cast<double>(n_fronts - rank) + bonus);
+}
+
+/**
+ * Ranks individuals with `non_dominated_sort` and `crowding_distance`, and stores their `pareto_fitness`.
+ *
+ * @param individuals the individuals to rank together
+ * @param objectives_of objectives of an individual (maximized)
+ * @param set_fitness stores the scalar fitness in the individual
+ */
+template<typename I, typename F>
+void assign_pareto_fitness(const std::vector<I*> &individuals,
+                           const std::function<Objectives(const I&)> &objectives_of,
+                           const std::function<void(I&, F)> &set_fitness)
+{
+    if (individuals.empty()) return;
+    std::vector<Objectives> points;
+    points.reserve(individuals.size());
+    for (const I *individual : individuals)
+        points.emplace_back(objectives_of(*individual));
+
+    const std::vector<unsigned int> ranks = non_dominated_sort(points);
+    const std::vector<double> crowding = crowding_distance(points, ranks);
+    const unsigned int n_fronts = *std::max_element(ranks.begin(), ranks.end()) + 1;
+    for (size_t i = 0; i < individuals.size(); i++)
+        set_fitness(*individuals[i], pareto_fitness<F>(ranks[i], crowding[i], n_fronts));
+}
+
+/**
+ * NSGA-II survivor selection, usable as `population_management` in `Genus::next_generation` (bind
+ * `objectives_of`): the old and new individuals of the species compete together, the best fronts survive and the
+ * last front that fits partially is cut by crowding distance.
+ *
+ * @param new_individuals new individuals of the species
+ * @param old_individuals individuals of the previous generation of the species, the survivors are cloned
+ * @param target_population number of survivors
+ * @param objectives_of objectives of an individual (maximized)
+ * @return the survivors
+ */
+template<typename I>
+std::vector<std::unique_ptr<I> > pareto_survivors(std::vector<std::unique_ptr<I> > &&new_individuals,
+                                                 const std::vector<const I *> &old_individuals,
+                                                 unsigned int target_population,
+                                                 const std::function<Objectives(const I&)> &objectives_of)
+{
+    const size_t n_new = new_individuals.size();
+    std::vector<Objectives> points;
+    points.reserve(n_new + old_individuals.size());
+    for (const std::unique_ptr<I> &individual : new_individuals)
+        points.emplace_back(objectives_of(*individual));
+    for (const I *individual : old_individuals)
+        points.emplace_back(objectives_of(*individual));
+
+    const std::vector<unsigned int> ranks = non_dominated_sort(points);
+    const std::vector<double> crowding = crowding_distance(points, ranks);
+
+    // best front first, then less crowded first, new individuals first on ties
+    std::vector<size_t> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    const size_t n_survivors = std::min<size_t>(target_population, order.size());
+    std::partial_sort(order.begin(), order.begin() + n_survivors, order.end(), [&](size_t a, size_t b) {
+        if (ranks[a] != ranks[b]) return ranks[a] < ranks[b];
+        if (crowding[a] != crowding[b]) return crowding[a] > crowding[b];
+        return a < b;
+    });
+
+    std::vector<std::unique_ptr<I> > survivors;
+    survivors.reserve(n_survivors);
+    for (size_t i = 0; i < n_survivors; i++) {
+        const size_t s = order[i];
+        if (s < n_new) survivors.emplace_back(std::move(new_individuals[s]));
+        else survivors.emplace_back(std::make_unique<I>(old_individuals[s - n_new]->clone()));
+    }
+    return survivors;
+}
+
+}
+
+#endif //SPECIATION_MULTIOBJECTIVE_H
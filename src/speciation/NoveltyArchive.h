@@ -0,0 +1,220 @@
+#ifndef SPECIATION_NOVELTYARCHIVE_H
+#define SPECIATION_NOVELTYARCHIVE_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace speciation {
+
+/**
+ * Archive of behavior descriptors for novelty search.
+ *
+ * The novelty of a behavior is the mean euclidean distance to its `k` nearest neighbours in the archive.
+ * The behaviors are stored by column (one contiguous array per dimension) and the neighbours are found by brute
+ * force, block by block: the distance loops run over contiguous memory without branches, so the compiler vectorizes
+ * them, and only the candidates closer than the current k-th neighbour reach the (small) heap.
+ * Insertion is a plain append.
+ *
+ * During a generation the archive is read-only: `novelty()` can be called concurrently and new behaviors are only
+ * proposed. `commit()` then inserts, in a fixed order, the proposals more novel than `insertion_threshold`.
+ * The scores do not depend on the evaluation order, so runs stay deterministic with any executor.
+ */
+class NoveltyArchive {
+    const size_t dimensions;
+    const unsigned int k;
+    const double insertion_threshold;
+
+    /// Archived behaviors, one column per dimension
+    std::vector<std::vector<double> > columns;
+
+    std::mutex proposals_mutex;
+    std::vector<std::vector<double> > proposals;
+
+    /// Number of behaviors whose distances are computed together
+    static constexpr size_t BLOCK_SIZE = 256;
+
+public:
+    /**
+     * @param dimensions size of the behavior descriptors
+     * @param k number of nearest neighbours averaged by the novelty
+     * @param insertion_threshold minimum novelty of a proposed behavior to be archived.
+     * While the archive holds less than `k` behaviors, all the proposals are archived.
+     */
+    NoveltyArchive(size_t dimensions, unsigned int k = 15, double insertion_threshold = 0.)
+            : dimensions(dimensions)
+            , k(k)
+            , insertion_threshold(insertion_threshold)
+    {
+        if (dimensions == 0 || k == 0)
+            throw std::invalid_argument("NoveltyArchive dimensions and k must be greater than zero");
+        columns.resize(dimensions);
+    }
+
+    NoveltyArchive(const NoveltyArchive &) = delete;
+    NoveltyArchive& operator=(const NoveltyArchive &) = delete;
+
+    /**
+     * Mean distance of the behavior to its k nearest archived behaviors (or all of them, if there are less than k).
+     * Thread safe, as long as `commit()` or `insert()` are not running.
+     * @return the novelty, 0 if the archive is empty
+     */
+    [[nodiscard]] double novelty(const std::vector<double> &behavior) const
+    {
+        _check_dimensions(behavior);
+        std::vector<double> nearest = _nearest_squared_distances(behavior.data());
+        if (nearest.empty())
+            return 0.;
+        double sum = 0.;
+        for (double squared_distance : nearest)
+            sum += std::sqrt(squared_distance);
+        return sum / static_cast<double>(nearest.size());
+    }
+
+    /**
+     * Proposes a behavior for the archive, it's considered by the next `commit()`. Thread safe.
+     */
+    void propose(std::vector<double> behavior)
+    {
+        _check_dimensions(behavior);
+        std::lock_guard<std::mutex> lock(proposals_mutex);
+        proposals.emplace_back(std::move(behavior));
+    }
+
+    /**
+     * Archives the proposed behaviors with novelty above the insertion threshold. Call it once per generation,
+     * after the evaluation.
+     * The proposals are sorted first, and every proposal is scored against the archive including the ones inserted
+     * before it: the archive does not depend on the order of the proposals.
+     * @return number of archived behaviors
+     */
+    size_t commit()
+    {
+        std::vector<std::vector<double> > pending;
+        {
+            std::lock_guard<std::mutex> lock(proposals_mutex);
+            pending.swap(proposals);
+        }
+        std::sort(pending.begin(), pending.end());
+
+        size_t inserted = 0;
+        for (const std::vector<double> &behavior : pending) {
+            if (size() < k || novelty(behavior) > insertion_threshold) {
+                insert(behavior);
+                inserted++;
+            }
+        }
+        return inserted;
+    }
+
+    /**
+     * Archives a behavior unconditionally.
+     */
+    void insert(const std::vector<double> &behavior)
+    {
+        _check_dimensions(behavior);
+        for (size_t d = 0; d < dimensions; d++)
+            columns[d].push_back(behavior[d]);
+    }
+
+    /**
+     * Wraps a behavior evaluation in a novelty evaluation. The returned function can be passed to
+     * `GenusSeed::evaluate()` or `Genus::ensure_evaluated_population()`, every evaluated behavior is proposed to the
+     * archive. The archive must outlive the returned function.
+     *
+     * For novelty+fitness hybrids, `evaluate_behavior` can store the objective in the individual and `set_fitness`
+     * combine it with the novelty.
+     *
+     * @param evaluate_behavior evaluates an individual and returns its behavior descriptor
+     * @param set_fitness stores in the individual the fitness for its novelty, and returns it
+     * @return novelty evaluation function
+     */
+    template<typename I, typename F>
+    std::function<F(I*)> wrap(std::function<std::vector<double>(I*)> evaluate_behavior,
+                              std::function<F(I&, double novelty)> set_fitness)
+    {
+        return [this, evaluate_behavior = std::move(evaluate_behavior), set_fitness = std::move(set_fitness)]
+                (I *individual) -> F {
+            std::vector<double> behavior = evaluate_behavior(individual);
+            const double behavior_novelty = novelty(behavior);
+            propose(std::move(behavior));
+            return set_fitness(*individual, behavior_novelty);
+        };
+    }
+
+    /// Number of archived behaviors
+    [[nodiscard]] size_t size() const { return columns[0].size(); }
+    [[nodiscard]] bool empty() const { return columns[0].empty(); }
+    [[nodiscard]] size_t behavior_dimensions() const { return dimensions; }
+
+    /// Archived behavior `i`
+    [[nodiscard]] std::vector<double> behavior(size_t i) const
+    {
+        std::vector<double> values(dimensions);
+        for (size_t d = 0; d < dimensions; d++)
+            values[d] = columns[d][i];
+        return values;
+    }
+
+    void reserve(size_t n_behaviors)
+    {
+        for (std::vector<double> &column : columns)
+            column.reserve(n_behaviors);
+    }
+
+private:
+    void _check_dimensions(const std::vector<double> &behavior) const
+    {
+        if (behavior.size() != dimensions)
+            throw std::invalid_argument("NoveltyArchive: wrong behavior descriptor size");
+    }
+
+    /**
+     * @return squared distances of the k nearest archived behaviors, in no particular order
+     */
+    std::vector<double> _nearest_squared_distances(const double *query) const
+    {
+        const size_t n = size();
+        const size_t n_nearest = std::min<size_t>(k, n);
+        // max-heap of the nearest distances found so far
+        std::vector<double> nearest;
+        nearest.reserve(n_nearest);
+        double worst = std::numeric_limits<double>::infinity();
+
+        double distances[BLOCK_SIZE];
+        for (size_t block_begin = 0; block_begin < n; block_begin += BLOCK_SIZE) {
+            const size_t block = std::min(BLOCK_SIZE, n - block_begin);
+            std::fill(distances, distances + block, 0.);
+            for (size_t d = 0; d < dimensions; d++) {
+                const double *column = columns[d].data() + block_begin;
+                const double q = query[d];
+                for (size_t r = 0; r < block; r++) {
+                    const double diff = column[r] - q;
+                    distances[r] += diff * diff;
+                }
+            }
+
+            for (size_t r = 0; r < block; r++) {
+                if (nearest.size() < n_nearest) {
+                    nearest.push_back(distances[r]);
+                    std::push_heap(nearest.begin(), nearest.end());
+                    if (nearest.size() == n_nearest) worst = nearest.front();
+                } else if (distances[r] < worst) {
+                    std::pop_heap(nearest.begin(), nearest.end());
+                    nearest.back() = distances[r];
+                    std::push_heap(nearest.begin(), nearest.end());
+                    worst = nearest.front();
+                }
+            }
+        }
+        return nearest;
+    }
+};
+
+}
+
+#endif //SPECIATION_NOVELTYARCHIVE_H
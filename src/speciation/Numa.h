@@ -0,0 +1,456 @@
+#ifndef SPECIATION_NUMA_H
+#define SPECIATION_NUMA_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Executor.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace speciation {
+
+/**
+ * CPUs of each NUMA node of the machine.
+ */
+struct NumaTopology {
+    /// CPU ids of each node, nodes without CPUs are not included
+    std::vector<std::vector<unsigned int> > node_cpus;
+
+    [[nodiscard]] size_t n_nodes() const { return node_cpus.size(); }
+
+    /**
+     * Parses a Linux cpu list, like "0-3,8,10-11"
+     * @return the listed ids, in order
+     */
+    static std::vector<unsigned int> parse_cpulist(const std::string &cpulist)
+    {
+        std::vector<unsigned int> cpus;
+        std::stringstream ranges(cpulist);
+        std::string range;
+        while (std::getline(ranges, range, ',')) {
+            if (range.find_first_not_of(" \n\t") == std::string::npos)
+                continue;
+            const size_t dash = range.find('-');
+            try {
+                const unsigned int first = std::stoul(range.substr(0, dash));
+                const unsigned int last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+                for (unsigned int cpu = first; cpu <= last; cpu++)
+                    cpus.emplace_back(cpu);
+            } catch (const std::logic_error &) {
+                return {};
+            }
+        }
+        return cpus;
+    }
+
+    /**
+     * One node with all the CPUs, for machines without NUMA
+     * @param n_cpus number of CPUs, 0 for `std::thread::hardware_concurrency()`
+     */
+    static NumaTopology single_node(unsigned int n_cpus = 0)
+    {
+        if (n_cpus == 0)
+            n_cpus = std::max(std::thread::hardware_concurrency(), 1u);
+        NumaTopology topology;
+        topology.node_cpus.emplace_back(n_cpus);
+        std::iota(topology.node_cpus[0].begin(), topology.node_cpus[0].end(), 0u);
+        return topology;
+    }
+
+    /**
+     * Reads the topology from the Linux sysfs.
+     * @param node_directory sysfs directory of the NUMA nodes
+     * @return the detected topology, a single node if it cannot be read (e.g. not on Linux)
+     */
+    static NumaTopology detect(const std::string &node_directory = "/sys/devices/system/node")
+    {
+        NumaTopology topology;
+        for (unsigned int node : parse_cpulist(_read_line(node_directory + "/online"))) {
+            std::vector<unsigned int> cpus =
+                    parse_cpulist(_read_line(node_directory + "/node" + std::to_string(node) + "/cpulist"));
+            if (!cpus.empty())
+                topology.node_cpus.emplace_back(std::move(cpus));
+        }
+        if (topology.node_cpus.empty())
+            return single_node();
+        return topology;
+    }
+
+private:
+    static std::string _read_line(const std::string &path)
+    {
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line);
+        return line;
+    }
+};
+
+/**
+ * Pins the calling thread to a set of CPUs.
+ * @return false if the affinity could not be set (e.g. not on Linux), the thread then runs anywhere
+ */
+inline bool pin_current_thread(const std::vector<unsigned int> &cpus)
+{
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (unsigned int cpu : cpus) {
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &cpu_set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+    (void) cpus;
+    return false;
+#endif
+}
+
+/**
+ * Assignment of the species to the NUMA nodes, balancing their load (e.g. number of offspring).
+ *
+ * A species stays on its node from one generation to the next, so its individuals remain node-local. New species go
+ * to the least loaded node. All the species are rebalanced (longest processing time first) only when the most loaded
+ * node exceeds the average load by more than `rebalance_threshold`, and the rebalancing reduces it.
+ */
+class NumaPlacement {
+    size_t n_nodes;
+    double rebalance_threshold;
+    /// Node of each species, by species id
+    std::unordered_map<unsigned int, unsigned int> species_node;
+    size_t _rebalances;
+
+public:
+    /**
+     * @param n_nodes number of nodes
+     * @param rebalance_threshold relative excess load over the average tolerated before rebalancing
+     */
+    explicit NumaPlacement(size_t n_nodes, double rebalance_threshold = 0.25)
+            : n_nodes(std::max<size_t>(n_nodes, 1))
+            , rebalance_threshold(rebalance_threshold)
+            , _rebalances(0)
+    {}
+
+    /**
+     * Places the species of the current generation. Species not listed are forgotten.
+     * @param species_ids id of each species
+     * @param loads load of each species, in the same order
+     * @return node of each species, in the same order
+     */
+    std::vector<unsigned int> place(const std::vector<unsigned int> &species_ids, const std::vector<unsigned int> &loads)
+    {
+        assert(species_ids.size() == loads.size());
+        std::vector<unsigned int> nodes(species_ids.size(), 0);
+        if (n_nodes == 1) {
+            species_node.clear();
+            for (unsigned int id : species_ids) species_node.emplace(id, 0);
+            return nodes;
+        }
+
+        // species by decreasing load
+        std::vector<size_t> order(species_ids.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&loads](size_t a, size_t b) { return loads[a] > loads[b]; });
+
+        // keep the known species where they are
+        std::vector<unsigned long> node_loads(n_nodes, 0);
+        std::vector<bool> placed(species_ids.size(), false);
+        for (size_t i = 0; i < species_ids.size(); i++) {
+            auto known = species_node.find(species_ids[i]);
+            if (known != species_node.end() && known->second < n_nodes) {
+                nodes[i] = known->second;
+                node_loads[nodes[i]] += loads[i];
+                placed[i] = true;
+            }
+        }
+        for (size_t i : order) {
+            if (placed[i]) continue;
+            nodes[i] = _least_loaded(node_loads);
+            node_loads[nodes[i]] += loads[i];
+        }
+
+        const unsigned long total_load = std::accumulate(node_loads.begin(), node_loads.end(), 0ul);
+        const unsigned long max_load = *std::max_element(node_loads.begin(), node_loads.end());
+        const double average_load = static_cast<double>(total_load) / static_cast<double>(n_nodes);
+        if (total_load > 0 && static_cast<double>(max_load) > average_load * (1. + rebalance_threshold)) {
+            std::vector<unsigned int> balanced_nodes(species_ids.size(), 0);
+            std::vector<unsigned long> balanced_loads(n_nodes, 0);
+            for (size_t i : order) {
+                balanced_nodes[i] = _least_loaded(balanced_loads);
+                balanced_loads[balanced_nodes[i]] += loads[i];
+            }
+            if (*std::max_element(balanced_loads.begin(), balanced_loads.end()) < max_load) {
+                nodes = std::move(balanced_nodes);
+                _rebalances++;
+            }
+        }
+
+        species_node.clear();
+        for (size_t i = 0; i < species_ids.size(); i++)
+            species_node.emplace(species_ids[i], nodes[i]);
+        return nodes;
+    }
+
+    /// Number of times the species were rebalanced
+    [[nodiscard]] size_t rebalances() const { return _rebalances; }
+
+private:
+    static unsigned int _least_loaded(const std::vector<unsigned long> &node_loads)
+    {
+        return static_cast<unsigned int>(
+                std::distance(node_loads.begin(), std::min_element(node_loads.begin(), node_loads.end())));
+    }
+};
+
+/**
+ * Runs tasks on pools of threads pinned to NUMA nodes, one pool per node, started with the executor.
+ *
+ * With `Genus::generate_new_individuals` and `GenusSeed::evaluate`, the offspring of a species are created and
+ * evaluated by threads of the node of the species (see `NumaPlacement`): with the default first-touch memory policy
+ * of Linux they are allocated on that node. On single node machines it's a plain parallel executor.
+ * `parallel_for` called by a thread of the executor runs on the node of that thread (e.g. the offspring of a species),
+ * called by other threads it spreads the tasks over all the nodes.
+ */
+class NumaExecutor final : public Executor {
+    /// Tasks of a single `parallel_for_nodes` call
+    struct Group {
+        /// Guards `pending` and `error`: the mutex of the node of the waiting thread, or `own_mutex`
+        std::mutex *mutex;
+        /// Notified when `pending` reaches 0
+        std::condition_variable *done;
+        size_t pending;
+        std::atomic<bool> failed;
+        std::exception_ptr error;
+        std::mutex own_mutex;
+        std::condition_variable own_done;
+    };
+
+    struct Task {
+        const std::function<void(size_t)> *body;
+        size_t i;
+        Group *group;
+    };
+
+    /// Pool of threads pinned to a node, with its queue of tasks
+    struct Node {
+        std::mutex mutex;
+        std::condition_variable wake_up;
+        std::deque<Task> tasks;
+        std::vector<std::thread> threads;
+    };
+
+    NumaTopology topology;
+    NumaPlacement placement;
+    std::vector<std::unique_ptr<Node> > nodes;
+    std::atomic<bool> stopping;
+
+public:
+    /**
+     * @param topology NUMA nodes to use
+     * @param threads_per_node number of threads on each node, 0 for one thread per CPU of the node
+     * @param rebalance_threshold see `NumaPlacement`
+     */
+    explicit NumaExecutor(NumaTopology topology = NumaTopology::detect(),
+                          unsigned int threads_per_node = 0,
+                          double rebalance_threshold = 0.25)
+            : topology(std::move(topology))
+            , placement(this->topology.n_nodes(), rebalance_threshold)
+            , stopping(false)
+    {
+        for (size_t node = 0; node < this->topology.n_nodes(); node++)
+            nodes.emplace_back(std::make_unique<Node>());
+        for (unsigned int node = 0; node < nodes.size(); node++) {
+            const size_t n_threads = std::max<size_t>(
+                    threads_per_node == 0 ? this->topology.node_cpus[node].size() : threads_per_node, 1);
+            for (size_t t = 0; t < n_threads; t++)
+                nodes[node]->threads.emplace_back([this, node]() { _worker_loop(node); });
+        }
+    }
+
+    NumaExecutor(const NumaExecutor &) = delete;
+    NumaExecutor& operator=(const NumaExecutor &) = delete;
+
+    ~NumaExecutor() override
+    {
+        for (std::unique_ptr<Node> &node : nodes) {
+            {
+                std::lock_guard<std::mutex> lock(node->mutex);
+                stopping = true;
+            }
+            node->wake_up.notify_all();
+        }
+        for (std::unique_ptr<Node> &node : nodes) {
+            for (std::thread &thread : node->threads) thread.join();
+        }
+    }
+
+    [[nodiscard]] size_t n_nodes() const { return topology.n_nodes(); }
+
+    void parallel_for(size_t n, const std::function<void(size_t)> &body) override
+    {
+        const int self = _current_node(this);
+        std::vector<unsigned int> task_nodes(n);
+        for (size_t i = 0; i < n; i++)
+            task_nodes[i] = self >= 0 ? static_cast<unsigned int>(self) : static_cast<unsigned int>(i % nodes.size());
+        parallel_for_nodes(task_nodes, body);
+    }
+
+    [[nodiscard]] unsigned int concurrency() const override
+    {
+        size_t threads = 0;
+        for (const std::unique_ptr<Node> &node : nodes)
+            threads += node->threads.size();
+        return static_cast<unsigned int>(threads);
+    }
+
+    /// Number of times the species were rebalanced across the nodes
+    [[nodiscard]] size_t rebalances() const { return placement.rebalances(); }
+
+    /**
+     * Places the species on the nodes, see `NumaPlacement::place`
+     */
+    std::vector<unsigned int> place_species(const std::vector<unsigned int> &species_ids,
+                                            const std::vector<unsigned int> &loads) override
+    {
+        return placement.place(species_ids, loads);
+    }
+
+    /**
+     * Node of the calling thread, -1 if it's not a thread of a NumaExecutor
+     */
+    static int current_node()
+    {
+        return _thread_node();
+    }
+
+    /**
+     * Runs `body(i)` for every task, on a thread of the node `task_nodes[i]`, and waits for all of them.
+     * A thread of the executor runs the tasks of its own node while it waits, so the calls can be nested.
+     * The first exception thrown by a task is rethrown once all the tasks are finished.
+     */
+    void parallel_for_nodes(const std::vector<unsigned int> &task_nodes,
+                            const std::function<void(size_t)> &body) override
+    {
+        if (task_nodes.empty()) return;
+
+        const int self = _current_node(this);
+        Group group;
+        group.mutex = self >= 0 ? &nodes[self]->mutex : &group.own_mutex;
+        group.done = self >= 0 ? &nodes[self]->wake_up : &group.own_done;
+        group.pending = task_nodes.size();
+        group.failed = false;
+
+        std::vector<std::vector<size_t> > node_tasks(nodes.size());
+        for (size_t i = 0; i < task_nodes.size(); i++)
+            node_tasks[task_nodes[i] % nodes.size()].emplace_back(i);
+        for (size_t node = 0; node < nodes.size(); node++) {
+            if (node_tasks[node].empty()) continue;
+            {
+                std::lock_guard<std::mutex> lock(nodes[node]->mutex);
+                for (size_t i : node_tasks[node])
+                    nodes[node]->tasks.push_back(Task{&body, i, &group});
+            }
+            nodes[node]->wake_up.notify_all();
+        }
+
+        std::unique_lock<std::mutex> lock(*group.mutex);
+        if (self >= 0) {
+            // help the other threads of the node while waiting
+            Node &node = *nodes[self];
+            while (group.pending > 0) {
+                if (node.tasks.empty()) {
+                    node.wake_up.wait(lock);
+                    continue;
+                }
+                Task task = node.tasks.front();
+                node.tasks.pop_front();
+                lock.unlock();
+                _run(task);
+                lock.lock();
+            }
+        } else {
+            group.done->wait(lock, [&group]() { return group.pending == 0; });
+        }
+        lock.unlock();
+
+        if (group.error) std::rethrow_exception(group.error);
+    }
+
+private:
+    static int& _thread_node()
+    {
+        static thread_local int node = -1;
+        return node;
+    }
+
+    static const NumaExecutor*& _thread_executor()
+    {
+        static thread_local const NumaExecutor *executor = nullptr;
+        return executor;
+    }
+
+    /// Node of the calling thread if it's a thread of `executor`, -1 otherwise
+    static int _current_node(const NumaExecutor *executor)
+    {
+        return _thread_executor() == executor ? _thread_node() : -1;
+    }
+
+    void _worker_loop(unsigned int n)
+    {
+        pin_current_thread(topology.node_cpus[n]);
+        _thread_executor() = this;
+        _thread_node() = static_cast<int>(n);
+
+        Node &node = *nodes[n];
+        std::unique_lock<std::mutex> lock(node.mutex);
+        for (;;) {
+            node.wake_up.wait(lock, [this, &node]() { return stopping || !node.tasks.empty(); });
+            if (node.tasks.empty()) return;
+            Task task = node.tasks.front();
+            node.tasks.pop_front();
+            lock.unlock();
+            _run(task);
+            lock.lock();
+        }
+    }
+
+    static void _run(const Task &task)
+    {
+        Group &group = *task.group;
+        if (!group.failed) {
+            try {
+                (*task.body)(task.i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(*group.mutex);
+                if (!group.error) group.error = std::current_exception();
+                group.failed = true;
+            }
+        }
+        // notified under the lock: the group is destroyed as soon as the waiting thread sees no pending tasks
+        std::lock_guard<std::mutex> lock(*group.mutex);
+        if (--group.pending == 0) group.done->notify_all();
+    }
+};
+
+}
+
+#endif //SPECIATION_NUMA_H
@@ -0,0 +1,423 @@
+#ifndef SPECIATION_PROCESSPOOL_H
+#define SPECIATION_PROCESSPOOL_H
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SPECIATION_HAS_PROCESS_POOL 1
+
+#include "GenusSeed.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace speciation {
+
+/**
+ * Configuration of the `ProcessPool`
+ */
+struct ProcessPoolConf {
+    /// Number of worker processes
+    unsigned int workers = 4;
+    /// Size of the shared memory used to transfer the genomes, split evenly between workers
+    size_t shared_memory_size = 64 * 1024 * 1024;
+    /// Maximum number of individuals sent to a worker in one message
+    unsigned int max_batch_size = 64;
+    /// Target number of batches per worker in each evaluation round (more batches = better load balance,
+    /// fewer batches = less IPC latency)
+    unsigned int batches_per_worker = 4;
+    /// How many times an individual that crashed a worker is retried before giving up
+    unsigned int max_retries = 2;
+};
+
+/**
+ * Evaluates individuals in a pool of forked worker processes, for evaluators that are not thread-safe.
+ *
+ * Genomes are written by the user serializer directly in a shared memory segment (one per worker), only the
+ * batch descriptors and the fitness results go through the Unix sockets.
+ * If a worker dies, it's restarted and the individual it was evaluating is retried
+ * (up to `ProcessPoolConf::max_retries` times), the rest of its batch is rescheduled.
+ *
+ * Workers are forked in the constructor, so the evaluator (and anything it needs) must be ready by then.
+ * Only available on POSIX systems (`SPECIATION_HAS_PROCESS_POOL` is defined).
+ *
+ * @tparam I individual type
+ * @tparam F fitness type, it must be trivially copyable
+ */
+template<typename I, typename F>
+class ProcessPool {
+    static_assert(std::is_trivially_copyable<F>::value, "Fitness must be trivially copyable to be sent between processes");
+
+public:
+    /// Writes the genome of the individual in `buffer` if it fits in `capacity` bytes. Returns the genome size.
+    using Serializer = std::function<size_t(const I &individual, char *buffer, size_t capacity)>;
+    /// Runs in the worker process: evaluates a serialized genome
+    using Evaluator = std::function<F(const char *genome, size_t size)>;
+    /// Runs in the main process: stores the fitness in the individual
+    using FitnessSetter = std::function<void(I &individual, F fitness)>;
+
+private:
+    struct GenomeDescriptor {
+        uint64_t offset;
+        uint64_t size;
+    };
+    struct Result {
+        uint32_t index_in_batch;
+        F fitness;
+    };
+
+    struct Worker {
+        pid_t pid = -1;
+        int socket = -1;
+        /// indices (in the evaluation round) of the individuals in the current batch
+        std::vector<size_t> batch;
+        size_t reported = 0;
+        bool busy() const { return !batch.empty(); }
+    };
+
+    ProcessPoolConf conf;
+    Serializer serialize;
+    Evaluator evaluate_genome;
+    FitnessSetter set_fitness;
+
+    char *shared_memory;
+    size_t segment_size;
+    std::vector<Worker> workers;
+    size_t _crashed_workers;
+
+public:
+    ProcessPool(ProcessPoolConf conf, Serializer serializer, Evaluator evaluator, FitnessSetter fitness_setter)
+            : conf(conf)
+            , serialize(std::move(serializer))
+            , evaluate_genome(std::move(evaluator))
+            , set_fitness(std::move(fitness_setter))
+            , shared_memory(nullptr)
+            , segment_size(0)
+            , workers(conf.workers)
+            , _crashed_workers(0)
+    {
+        if (conf.workers == 0)
+            throw std::invalid_argument("ProcessPool needs at least one worker");
+        if (conf.max_batch_size == 0)
+            throw std::invalid_argument("ProcessPool batch size must be greater than zero");
+
+        segment_size = conf.shared_memory_size / conf.workers;
+        void *memory = mmap(nullptr, segment_size * conf.workers, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            _throw_errno("mmap");
+        shared_memory = static_cast<char *>(memory);
+
+        for (size_t i = 0; i < workers.size(); i++) {
+            _spawn(i);
+        }
+    }
+
+    ProcessPool(const ProcessPool &) = delete;
+    ProcessPool& operator=(const ProcessPool &) = delete;
+
+    ~ProcessPool()
+    {
+        // Closing the sockets makes the idle workers exit
+        for (Worker &worker : workers) {
+            if (worker.socket >= 0) close(worker.socket);
+            worker.socket = -1;
+        }
+        for (Worker &worker : workers) {
+            int status;
+            if (worker.pid > 0) waitpid(worker.pid, &status, 0);
+        }
+        if (shared_memory != nullptr)
+            munmap(shared_memory, segment_size * workers.size());
+    }
+
+    /**
+     * Evaluates all the new individuals of the seed (drop-in replacement for `GenusSeed::evaluate`)
+     */
+    void evaluate(GenusSeed<I, F> &seed)
+    {
+        evaluate(seed.begin(), seed.end());
+    }
+
+    /**
+     * Evaluates a range of individuals. Blocks until all of them are evaluated.
+     *
+     * @tparam Iter iterator of `I*`
+     */
+    template<typename Iter>
+    void evaluate(Iter begin, Iter end)
+    {
+        std::vector<I *> individuals(begin, end);
+        std::vector<unsigned int> retries(individuals.size(), 0);
+        std::deque<size_t> pending;
+        for (size_t i = 0; i < individuals.size(); i++) pending.push_back(i);
+
+        try {
+            _evaluation_loop(individuals, retries, pending);
+        } catch (...) {
+            // Do not leave batches in flight for the next call
+            for (size_t w = 0; w < workers.size(); w++) {
+                if (workers[w].busy()) {
+                    _stop(workers[w]);
+                    _spawn(w);
+                }
+            }
+            throw;
+        }
+    }
+
+    /// Number of workers that died and had to be restarted
+    [[nodiscard]] size_t crashed_workers() const {
+        return _crashed_workers;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return workers.size();
+    }
+
+private:
+    void _evaluation_loop(const std::vector<I *> &individuals, std::vector<unsigned int> &retries, std::deque<size_t> &pending)
+    {
+        size_t completed = 0;
+        std::vector<pollfd> poll_fds;
+        std::vector<size_t> poll_workers;
+
+        while (completed < individuals.size()) {
+            // Dispatch work to idle workers
+            const size_t batch_size = _batch_size(pending.size());
+            for (size_t w = 0; w < workers.size() && !pending.empty(); w++) {
+                if (!workers[w].busy())
+                    _send_batch(w, individuals, pending, batch_size);
+            }
+
+            // Wait for results
+            poll_fds.clear();
+            poll_workers.clear();
+            for (size_t w = 0; w < workers.size(); w++) {
+                if (workers[w].busy()) {
+                    poll_fds.push_back(pollfd{workers[w].socket, POLLIN, 0});
+                    poll_workers.push_back(w);
+                }
+            }
+            assert(!poll_fds.empty());
+            if (poll(poll_fds.data(), poll_fds.size(), -1) < 0) {
+                if (errno == EINTR) continue;
+                _throw_errno("poll");
+            }
+
+            for (size_t p = 0; p < poll_fds.size(); p++) {
+                if (poll_fds[p].revents == 0) continue;
+                Worker &worker = workers[poll_workers[p]];
+
+                Result result{};
+                if (_read_all(worker.socket, &result, sizeof(result))) {
+                    assert(result.index_in_batch == worker.reported);
+                    set_fitness(*individuals[worker.batch[worker.reported]], result.fitness);
+                    completed++;
+                    if (++worker.reported == worker.batch.size()) {
+                        worker.batch.clear();
+                        worker.reported = 0;
+                    }
+                } else {
+                    _recover(poll_workers[p], retries, pending);
+                }
+            }
+        }
+    }
+
+    [[noreturn]] static void _throw_errno(const char *what)
+    {
+        std::stringstream error_message;
+        error_message << "ProcessPool: " << what << " failed: " << std::strerror(errno);
+        throw std::runtime_error(error_message.str());
+    }
+
+    size_t _batch_size(size_t pending) const
+    {
+        const size_t rounds = static_cast<size_t>(workers.size()) * std::max(1u, conf.batches_per_worker);
+        const size_t size = (pending + rounds - 1) / rounds;
+        return std::clamp<size_t>(size, 1, conf.max_batch_size);
+    }
+
+    static bool _write_all(int fd, const void *data, size_t size)
+    {
+        const char *bytes = static_cast<const char *>(data);
+        while (size > 0) {
+#ifdef MSG_NOSIGNAL
+            ssize_t written = send(fd, bytes, size, MSG_NOSIGNAL);
+#else
+            ssize_t written = send(fd, bytes, size, 0);
+#endif
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    static bool _read_all(int fd, void *data, size_t size)
+    {
+        char *bytes = static_cast<char *>(data);
+        while (size > 0) {
+            ssize_t n_read = read(fd, bytes, size);
+            if (n_read < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            if (n_read == 0) return false;
+            bytes += n_read;
+            size -= static_cast<size_t>(n_read);
+        }
+        return true;
+    }
+
+    void _send_batch(size_t worker_i, const std::vector<I *> &individuals, std::deque<size_t> &pending, size_t batch_size)
+    {
+        Worker &worker = workers[worker_i];
+        char *segment = shared_memory + worker_i * segment_size;
+        std::vector<GenomeDescriptor> descriptors;
+        uint64_t offset = 0;
+
+        while (!pending.empty() && worker.batch.size() < batch_size) {
+            const size_t index = pending.front();
+            const size_t size = serialize(*individuals[index], segment + offset, segment_size - offset);
+            if (size > segment_size - offset) {
+                if (worker.batch.empty()) {
+                    std::stringstream error_message;
+                    error_message << "ProcessPool: serialized genome (" << size << " bytes) does not fit in the "
+                                     "shared memory segment of a worker (" << segment_size << " bytes)";
+                    throw std::length_error(error_message.str());
+                }
+                break;
+            }
+            pending.pop_front();
+            worker.batch.push_back(index);
+            descriptors.push_back(GenomeDescriptor{offset, size});
+            offset += size;
+        }
+
+        const uint64_t count = descriptors.size();
+        if (!_write_all(worker.socket, &count, sizeof(count))
+            || !_write_all(worker.socket, descriptors.data(), descriptors.size() * sizeof(GenomeDescriptor))) {
+            // The worker is dead, the error will be picked up by poll() as end of file
+            return;
+        }
+    }
+
+    void _recover(size_t worker_i, std::vector<unsigned int> &retries, std::deque<size_t> &pending)
+    {
+        Worker &worker = workers[worker_i];
+        _crashed_workers++;
+
+        // The individual being evaluated is the culprit, the rest of the batch was never started
+        const size_t culprit = worker.batch[worker.reported];
+        if (++retries[culprit] > conf.max_retries) {
+            _stop(worker);
+            _spawn(worker_i);
+            std::stringstream error_message;
+            error_message << "ProcessPool: individual crashed the worker " << retries[culprit] << " times";
+            throw std::runtime_error(error_message.str());
+        }
+        for (auto it = worker.batch.rbegin(); it != worker.batch.rend() - worker.reported; it++) {
+            pending.push_front(*it);
+        }
+
+        _stop(worker);
+        _spawn(worker_i);
+    }
+
+    void _spawn(size_t worker_i)
+    {
+        int sockets[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+            _throw_errno("socketpair");
+#if defined(SO_NOSIGPIPE)
+        int on = 1;
+        setsockopt(sockets[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(sockets[0]);
+            close(sockets[1]);
+            _throw_errno("fork");
+        }
+
+        if (pid == 0) {
+            // Worker process
+            close(sockets[0]);
+            for (const Worker &other : workers) {
+                if (other.socket >= 0) close(other.socket);
+            }
+            _worker_loop(sockets[1], shared_memory + worker_i * segment_size);
+        }
+
+        close(sockets[1]);
+        Worker &worker = workers[worker_i];
+        worker.pid = pid;
+        worker.socket = sockets[0];
+        worker.batch.clear();
+        worker.reported = 0;
+    }
+
+    [[noreturn]] void _worker_loop(int socket, const char *segment)
+    {
+        try {
+            std::vector<GenomeDescriptor> descriptors;
+            uint64_t count;
+            while (_read_all(socket, &count, sizeof(count))) {
+                descriptors.resize(count);
+                if (!_read_all(socket, descriptors.data(), count * sizeof(GenomeDescriptor)))
+                    break;
+                for (uint32_t i = 0; i < count; i++) {
+                    Result result{};
+                    result.index_in_batch = i;
+                    result.fitness = evaluate_genome(segment + descriptors[i].offset, descriptors[i].size);
+                    if (!_write_all(socket, &result, sizeof(result)))
+                        _exit(1);
+                }
+            }
+        } catch (...) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+
+    static void _stop(Worker &worker)
+    {
+        if (worker.socket >= 0) {
+            close(worker.socket);
+            worker.socket = -1;
+        }
+        if (worker.pid > 0) {
+            int status;
+            kill(worker.pid, SIGKILL);
+            waitpid(worker.pid, &status, 0);
+            worker.pid = -1;
+        }
+        worker.batch.clear();
+        worker.reported = 0;
+    }
+};
+
+}
+
+#endif // unix
+
+#endif //SPECIATION_PROCESSPOOL_H
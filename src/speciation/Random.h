@@ -5,11 +5,434 @@
 #ifndef SPECIATION_RANDOM_H
 #define SPECIATION_RANDOM_H
 
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <limits>
 #include <random>
 
+namespace speciation {
+
+/**
+ * Full 128 bits product of two 64 bits numbers.
+ * @param a first factor
+ * @param b second factor
+ * @param high output, higher 64 bits of the product
+ * @return lower 64 bits of the product
+ */
+inline uint64_t mul_64x64_128(uint64_t a, uint64_t b, uint64_t &high)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    high = static_cast<uint64_t>(product >> 64);
+    return static_cast<uint64_t>(product);
+#else
+    const uint64_t a_lo = a & 0xFFFFFFFFu, a_hi = a >> 32;
+    const uint64_t b_lo = b & 0xFFFFFFFFu, b_hi = b >> 32;
+    const uint64_t lo_lo = a_lo * b_lo;
+    const uint64_t hi_lo = a_hi * b_lo;
+    const uint64_t lo_hi = a_lo * b_hi;
+    const uint64_t hi_hi = a_hi * b_hi;
+    const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFu) + lo_hi;
+    high = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    return (cross << 32) | (lo_lo & 0xFFFFFFFFu);
+#endif
+}
+
+/**
+ * Draws 64 uniformly distributed random bits from any UniformRandomBitGenerator.
+ * Engines that already produce 64 (or 32) full bits are used directly.
+ */
+template<typename RandomGenerator>
+inline uint64_t random_bits_64(RandomGenerator &g)
+{
+    constexpr uint64_t range = static_cast<uint64_t>(RandomGenerator::max() - RandomGenerator::min());
+    if constexpr (range == std::numeric_limits<uint64_t>::max()) {
+        return static_cast<uint64_t>(g() - RandomGenerator::min());
+    } else if constexpr (range == std::numeric_limits<uint32_t>::max()) {
+        const uint64_t high = static_cast<uint64_t>(g() - RandomGenerator::min());
+        const uint64_t low = static_cast<uint64_t>(g() - RandomGenerator::min());
+        return (high << 32) | low;
+    } else {
+        std::uniform_int_distribution<uint64_t> dis;
+        return dis(g);
+    }
+}
+
+/**
+ * Uniform random integer in [0, range), with Lemire's nearly divisionless method.
+ * In the common case it costs one multiplication and no division.
+ * https://arxiv.org/abs/1805.10941
+ *
+ * @param g random generator
+ * @param range size of the interval, must be > 0
+ * @return random number in [0, range)
+ */
+template<typename RandomGenerator>
+inline uint64_t bounded_rand(RandomGenerator &g, uint64_t range)
+{
+    constexpr uint64_t engine_range = static_cast<uint64_t>(RandomGenerator::max() - RandomGenerator::min());
+    if constexpr (engine_range == std::numeric_limits<uint32_t>::max()) {
+        // 32 bits engines (e.g. std::mt19937) need only one call for small ranges
+        if (range <= std::numeric_limits<uint32_t>::max()) {
+            const uint32_t range32 = static_cast<uint32_t>(range);
+            uint64_t m = static_cast<uint64_t>(g() - RandomGenerator::min()) * range32;
+            uint32_t low = static_cast<uint32_t>(m);
+            if (low < range32) {
+                const uint32_t threshold = static_cast<uint32_t>(-range32) % range32;
+                while (low < threshold) {
+                    m = static_cast<uint64_t>(g() - RandomGenerator::min()) * range32;
+                    low = static_cast<uint32_t>(m);
+                }
+            }
+            return m >> 32;
+        }
+    }
+
+    uint64_t high;
+    uint64_t low = mul_64x64_128(random_bits_64(g), range, high);
+    if (low < range) {
+        const uint64_t threshold = (0 - range) % range;
+        while (low < threshold) {
+            low = mul_64x64_128(random_bits_64(g), range, high);
+        }
+    }
+    return high;
+}
+
+/**
+ * SplitMix64, used to expand a single 64 bits seed into the state of the other engines.
+ */
+class SplitMix64 {
+    uint64_t state;
+public:
+    using result_type = uint64_t;
+
+    explicit SplitMix64(uint64_t seed = 0) : state(seed) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+/**
+ * xoshiro256++ engine. 32 bytes of state, fast and with good statistical quality.
+ * http://prng.di.unimi.it/
+ */
+class Xoshiro256PlusPlus {
+    std::array<uint64_t, 4> s;
+
+    static constexpr uint64_t rotl(const uint64_t x, int k)
+    { return (x << k) | (x >> (64 - k)); }
+
+public:
+    using result_type = uint64_t;
+
+    explicit Xoshiro256PlusPlus(uint64_t seed = 0)
+    {
+        this->seed(seed);
+    }
+
+    void seed(uint64_t seed)
+    {
+        SplitMix64 seeder(seed);
+        for (uint64_t &word : s) word = seeder();
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()()
+    {
+        const uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+        const uint64_t t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+
+        return result;
+    }
+
+    /**
+     * Advances the state by 2^128 calls.
+     * It can be used to generate 2^128 non-overlapping sub-sequences for parallel computations.
+     */
+    void jump()
+    {
+        static constexpr uint64_t JUMP[] = {
+                0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c };
+
+        std::array<uint64_t, 4> jumped = {0, 0, 0, 0};
+        for (uint64_t jump_word : JUMP) {
+            for (int b = 0; b < 64; b++) {
+                if (jump_word & (uint64_t(1) << b)) {
+                    for (size_t i = 0; i < 4; i++) jumped[i] ^= s[i];
+                }
+                (*this)();
+            }
+        }
+        s = jumped;
+    }
+
+    bool operator==(const Xoshiro256PlusPlus &other) const { return s == other.s; }
+    bool operator!=(const Xoshiro256PlusPlus &other) const { return s != other.s; }
+};
+
+/**
+ * PCG64 engine (PCG XSL RR 128/64). 128 bits of state plus a 128 bits stream selector.
+ * https://www.pcg-random.org/
+ */
+class PCG64 {
+    // 128 bits values as (high, low) pairs, to not depend on compiler extensions
+    uint64_t state_hi, state_lo;
+    uint64_t inc_hi, inc_lo;
+
+    static constexpr uint64_t MULTIPLIER_HI = 0x2360ED051FC65DA4ull;
+    static constexpr uint64_t MULTIPLIER_LO = 0x4385DF649FCCF645ull;
+
+    void step()
+    {
+        // state = state * MULTIPLIER + inc (mod 2^128)
+        uint64_t high;
+        uint64_t low = mul_64x64_128(state_lo, MULTIPLIER_LO, high);
+        high += state_hi * MULTIPLIER_LO + state_lo * MULTIPLIER_HI;
+        state_lo = low + inc_lo;
+        state_hi = high + inc_hi + (state_lo < low ? 1 : 0);
+    }
+
+public:
+    using result_type = uint64_t;
+
+    /**
+     * @param seed initial state
+     * @param stream selects one of the 2^127 independent sequences
+     */
+    explicit PCG64(uint64_t seed = 0, uint64_t stream = 0)
+    {
+        this->seed(seed, stream);
+    }
+
+    void seed(uint64_t seed, uint64_t stream = 0)
+    {
+        SplitMix64 seeder(seed);
+        // increment must be odd
+        inc_hi = stream;
+        inc_lo = (seeder() << 1u) | 1u;
+        state_hi = 0;
+        state_lo = 0;
+        step();
+        state_hi += seeder();
+        state_lo += seeder();
+        step();
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()()
+    {
+        step();
+        const uint64_t xored = state_hi ^ state_lo;
+        const unsigned int rotation = static_cast<unsigned int>(state_hi >> 58u);
+        return (xored >> rotation) | (xored << ((64u - rotation) & 63u));
+    }
+
+    bool operator==(const PCG64 &other) const
+    {
+        return state_hi == other.state_hi && state_lo == other.state_lo
+               && inc_hi == other.inc_hi && inc_lo == other.inc_lo;
+    }
+    bool operator!=(const PCG64 &other) const { return !(*this == other); }
+};
+
+/**
+ * Counter-based Philox4x32-10 engine.
+ *
+ * The output is a pure function of (key, counter), so there is no state to share between threads:
+ * every thread, species or offspring can get its own independent stream with `split()`,
+ * and the results do not depend on the order in which the streams are consumed.
+ * Salmon et al. "Parallel random numbers: as easy as 1, 2, 3" (SC11)
+ */
+class Philox4x32 {
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    Key key;
+    /// counter[0..1] is the position in the stream, counter[2..3] is the stream id
+    Counter counter;
+    Counter output;
+    unsigned int output_index;
+
+    static constexpr uint32_t M0 = 0xD2511F53u;
+    static constexpr uint32_t M1 = 0xCD9E8D57u;
+    static constexpr uint32_t W0 = 0x9E3779B9u;
+    static constexpr uint32_t W1 = 0xBB67AE85u;
+
+    static Counter round(const Counter &ctr, const Key &k)
+    {
+        const uint64_t p0 = static_cast<uint64_t>(M0) * ctr[0];
+        const uint64_t p1 = static_cast<uint64_t>(M1) * ctr[2];
+        return Counter {
+                static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ k[0],
+                static_cast<uint32_t>(p1),
+                static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ k[1],
+                static_cast<uint32_t>(p0),
+        };
+    }
+
+    void increment_counter()
+    {
+        if (++counter[0] == 0) ++counter[1];
+    }
+
+    Philox4x32(Key key, Counter counter)
+            : key(key)
+            , counter(counter)
+            , output()
+            , output_index(4)
+    {}
+
+public:
+    using result_type = uint32_t;
+
+    /**
+     * @param seed run seed, used as key
+     * @param stream id of the stream
+     */
+    explicit Philox4x32(uint64_t seed = 0, uint64_t stream = 0)
+            : Philox4x32(
+                    Key { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) },
+                    Counter { 0, 0, static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32) })
+    {}
+
+    /**
+     * The Philox bijection: 10 rounds over a counter block.
+     * @return 128 random bits for the given key and counter
+     */
+    static Counter block(Counter ctr, Key k)
+    {
+        for (int i = 0; i < 10; i++) {
+            ctr = round(ctr, k);
+            k[0] += W0;
+            k[1] += W1;
+        }
+        return ctr;
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()()
+    {
+        if (output_index >= 4) {
+            output = block(counter, key);
+            increment_counter();
+            output_index = 0;
+        }
+        return output[output_index++];
+    }
+
+    /**
+     * Creates an independent generator with the same key, for the sub-stream `id` of the current stream.
+     * Splitting is deterministic: the same chain of ids always gives the same generator,
+     * regardless of how much the parent generator has been used.
+     *
+     * @param id sub-stream identifier (e.g. thread, species or offspring number)
+     * @return a new generator at the start of the sub-stream
+     */
+    [[nodiscard]] Philox4x32 split(uint64_t id) const
+    {
+        // Derive the new stream id by running the bijection on (parent stream, id)
+        const Counter mixed = block(
+                Counter { static_cast<uint32_t>(id), static_cast<uint32_t>(id >> 32), counter[2], counter[3] },
+                Key { key[0] ^ 0xA4093822u, key[1] ^ 0x299F31D0u });
+        return Philox4x32(key, Counter { 0, 0, mixed[0] ^ mixed[2], mixed[1] ^ mixed[3] });
+    }
+
+    /**
+     * Skips `n` blocks of 4 outputs in O(1)
+     */
+    void discard_blocks(uint64_t n)
+    {
+        uint64_t position = (static_cast<uint64_t>(counter[1]) << 32) | counter[0];
+        position += n;
+        counter[0] = static_cast<uint32_t>(position);
+        counter[1] = static_cast<uint32_t>(position >> 32);
+        output_index = 4;
+    }
+
+    bool operator==(const Philox4x32 &other) const
+    {
+        return key == other.key && counter == other.counter && output_index == other.output_index
+               && (output_index >= 4 || output == other.output);
+    }
+    bool operator!=(const Philox4x32 &other) const { return !(*this == other); }
+};
+
+/**
+ * Random streams of a deterministic run, see the `Genus` functions taking a `RandomStreams`.
+ *
+ * Every stream is derived from the run seed and from what consumes it (e.g. the n-th offspring of a species in a
+ * generation), never from the thread that runs it: the run gives the same result with any number of threads.
+ */
+class RandomStreams {
+    Philox4x32 root;
+
+    enum Domain : uint64_t {
+        OFFSPRING = 0,
+        SPECIES = 1,
+    };
+
+public:
+    /**
+     * @param seed seed of the run
+     */
+    explicit RandomStreams(uint64_t seed)
+            : root(seed)
+    {}
+
+    /**
+     * Stream for generating an offspring.
+     * @param generation generation number, see `Genus::generation()`
+     * @param species_id id of the parent species
+     * @param offspring_index index of the offspring in the species
+     */
+    [[nodiscard]] Philox4x32 offspring(unsigned int generation, unsigned int species_id, uint64_t offspring_index) const
+    {
+        return root.split(OFFSPRING).split(generation).split(species_id).split(offspring_index);
+    }
+
+    /**
+     * Stream for the work done once per species in a generation (e.g. population management).
+     * @param generation generation number, see `Genus::generation()`
+     * @param species_id id of the species
+     */
+    [[nodiscard]] Philox4x32 species(unsigned int generation, unsigned int species_id) const
+    {
+        return root.split(SPECIES).split(generation).split(species_id);
+    }
+};
+
+}
+
 /**
  * Select randomly from an iterator
  *
+ * The index is drawn with `speciation::bounded_rand`. `std::next` is O(1) for random access iterators,
+ * but O(n) on the others (e.g. std::forward_list).
+ *
  * @tparam Iter
  * @tparam RandomGenerator
  * @param start
@@ -19,9 +442,9 @@
  */
 template<typename Iter, typename RandomGenerator>
 Iter select_randomly(Iter start, Iter end, RandomGenerator& g) {
-    std::uniform_int_distribution<> dis(0, std::distance(start, end) - 1);
-    std::advance(start, dis(g));
-    return start;
+    const auto size = std::distance(start, end);
+    return std::next(start, static_cast<typename std::iterator_traits<Iter>::difference_type>(
+            speciation::bounded_rand(g, static_cast<uint64_t>(size))));
 }
 
 #endif //SPECIATION_RANDOM_H
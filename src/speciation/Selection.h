@@ -5,12 +5,17 @@
 #ifndef SPECIATION_SELECTION_H
 #define SPECIATION_SELECTION_H
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <vector>
 #include <functional>
+#include <memory>
+#include <numeric>
 #include <optional>
 #include <set>
 #include <sstream>
+#include <unordered_map>
 #include "Random.h"
 
 namespace speciation {
@@ -27,6 +32,12 @@ inline std::optional<F> indiv_fitness(Iter& indiv)
     return (*indiv).individual->fitness();
 }
 
+template<typename F, typename Iter>
+inline std::optional<F> indiv_adjusted_fitness(Iter& indiv)
+{
+    return (*indiv).adjusted_fitness;
+}
+
 /**
  * Perform tournament selection and return best individual
  *
@@ -52,6 +63,294 @@ Iter tournament_selection(const Iter begin, const Iter end, RandomGenerator &g,
     return best;
 }
 
+/**
+ * Walker/Vose alias table.
+ * Built in O(n) from a list of non-negative weights, it samples an index
+ * with probability proportional to its weight in O(1).
+ *
+ * If all the weights are zero, the sampling is uniform.
+ */
+class AliasTable {
+    /// Probability of keeping the column instead of jumping to its alias
+    std::vector<double> probability;
+    /// Alias of every column
+    std::vector<size_t> alias;
+
+public:
+    AliasTable() = default;
+
+    /**
+     * Builds the alias table
+     *
+     * @tparam WeightIter iterator of values convertible to double
+     * @param weights_begin start of the weights
+     * @param weights_end end of the weights
+     */
+    template<typename WeightIter>
+    AliasTable(WeightIter weights_begin, WeightIter weights_end)
+    {
+        std::vector<double> weights(weights_begin, weights_end);
+        const size_t n = weights.size();
+        if (n == 0) throw std::invalid_argument("Alias table cannot be built on an empty set of weights");
+
+        double total = 0;
+        for (double w : weights) {
+            if (w < 0 || std::isnan(w)) throw std::invalid_argument("Alias table weights must be non-negative");
+            total += w;
+        }
+
+        probability.resize(n);
+        alias.resize(n);
+
+        // Degenerate case, every column is equally likely
+        if (total <= 0) {
+            std::fill(probability.begin(), probability.end(), 1.0);
+            std::iota(alias.begin(), alias.end(), 0);
+            return;
+        }
+
+        std::vector<size_t> small, large;
+        small.reserve(n);
+        large.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            weights[i] = weights[i] * static_cast<double>(n) / total;
+            if (weights[i] < 1.0)
+                small.emplace_back(i);
+            else
+                large.emplace_back(i);
+        }
+
+        while (!small.empty() && !large.empty()) {
+            size_t less = small.back(); small.pop_back();
+            size_t more = large.back(); large.pop_back();
+
+            probability[less] = weights[less];
+            alias[less] = more;
+
+            weights[more] = (weights[more] + weights[less]) - 1.0;
+            if (weights[more] < 1.0)
+                small.emplace_back(more);
+            else
+                large.emplace_back(more);
+        }
+
+        // What is left is (up to rounding errors) exactly 1
+        for (size_t i : large) {
+            probability[i] = 1.0;
+            alias[i] = i;
+        }
+        for (size_t i : small) {
+            probability[i] = 1.0;
+            alias[i] = i;
+        }
+    }
+
+    /**
+     * Samples an index from the table in O(1)
+     * @param g random generator
+     * @return the sampled index, in [0, size())
+     */
+    template<typename RandomGenerator>
+    size_t operator()(RandomGenerator &g) const
+    {
+        assert(!probability.empty());
+        std::uniform_real_distribution<double> coin_dis(0.0, 1.0);
+        const size_t column = static_cast<size_t>(bounded_rand(g, probability.size()));
+        return coin_dis(g) < probability[column] ? column : alias[column];
+    }
+
+    [[nodiscard]] size_t size() const { return probability.size(); }
+    [[nodiscard]] bool empty() const { return probability.empty(); }
+};
+
+/**
+ * Fitness proportional selection (roulette wheel) backed by an `AliasTable`.
+ *
+ * The table of a species is built the first time that species is selected from, every following
+ * draw is O(1). Tables are cached for the current generation token, by the address of the first element of the
+ * range: an address alone can't tell a population that was refilled or reallocated in the meantime.
+ *
+ * It can be passed as the `selection` parameter of `Genus::generate_new_individuals`, which takes a
+ * copy of it every generation, so the tables are rebuilt once per species per generation.
+ * If you keep a long-lived instance instead (e.g. through `std::ref`), give it a new token with `set_generation()`
+ * (e.g. `Genus::generation()`) every time the populations change.
+ *
+ * Not thread safe: the table cache and the random generator are shared by every call without a lock, so it must not
+ * be passed to the `Executor` overloads of `Genus::generate_new_individuals`.
+ *
+ * @tparam F fitness type
+ * @tparam Iter points to an element that can be passed to `Fitness`
+ * @tparam Fitness weight of each element, by default the adjusted fitness of a `Species::Indiv`.
+ * Missing values count as zero.
+ */
+template<typename F, typename Iter, typename std::optional<F> Fitness(Iter&) = indiv_adjusted_fitness<F, Iter>, typename RandomGenerator = std::mt19937>
+class AliasSelection {
+    RandomGenerator *g;
+    uint64_t generation;
+    std::unordered_map<const void*, AliasTable> tables;
+public:
+    /**
+     * @param g random generator
+     * @param generation token of the populations the tables are built for
+     */
+    explicit AliasSelection(RandomGenerator &g, uint64_t generation = 0) : g(&g), generation(generation) {}
+
+    Iter operator()(const Iter begin, const Iter end)
+    {
+        if (begin == end) throw std::invalid_argument("Source selection cannot be empty");
+        const void *key = std::addressof(*begin);
+        const size_t size = static_cast<size_t>(std::distance(begin, end));
+
+        auto table = tables.find(key);
+        if (table == tables.end() || table->second.size() != size) {
+            std::vector<double> weights;
+            for (Iter it = begin; it != end; it++) {
+                weights.emplace_back(static_cast<double>(Fitness(it).value_or(0)));
+            }
+            table = tables.insert_or_assign(key, AliasTable(weights.begin(), weights.end())).first;
+        }
+
+        return std::next(begin, table->second(*g));
+    }
+
+    /**
+     * Moves to the populations identified by `token`, the built tables are forgotten if it's a new one.
+     */
+    void set_generation(uint64_t token)
+    {
+        if (token == generation) return;
+        generation = token;
+        tables.clear();
+    }
+
+    /**
+     * Forgets all built tables, to be called when the underlying populations change.
+     */
+    void reset() { tables.clear(); }
+};
+
+/**
+ * Stochastic universal sampling.
+ * Selects `n` elements proportionally to their fitness in a single O(size + n) sweep, using evenly spaced pointers.
+ * Every element is selected either floor or ceil of its expected number of times.
+ *
+ * @tparam Iter points to an element that can be passed to `Fitness`
+ * @param begin start of the selection pool
+ * @param end end of the selection pool
+ * @param n number of elements to select
+ * @param g random generator
+ * @return the selected elements, in population order. Missing fitness values count as zero,
+ * if all fitnesses are zero the selection is evenly spaced.
+ */
+template<typename F, typename Iter, typename std::optional<F> Fitness(Iter&) = indiv_fitness<F, Iter>, typename RandomGenerator>
+std::vector<Iter> stochastic_universal_sampling(const Iter begin, const Iter end, size_t n, RandomGenerator &g)
+{
+    if (begin == end) throw std::invalid_argument("Source selection cannot be empty");
+
+    std::vector<double> weights;
+    for (Iter it = begin; it != end; it++) {
+        double w = static_cast<double>(Fitness(it).value_or(0));
+        if (w < 0) throw std::invalid_argument("Stochastic universal sampling does not support negative fitness");
+        weights.emplace_back(w);
+    }
+    double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+    if (total <= 0) {
+        std::fill(weights.begin(), weights.end(), 1.0);
+        total = static_cast<double>(weights.size());
+    }
+
+    std::vector<Iter> selected;
+    selected.reserve(n);
+    if (n == 0) return selected;
+
+    const double step = total / static_cast<double>(n);
+    std::uniform_real_distribution<double> dis(0.0, step);
+    double pointer = dis(g);
+    double cumulative = 0;
+    size_t i = 0;
+    Iter it = begin;
+    for (; it != end && selected.size() < n; it++, i++) {
+        cumulative += weights[i];
+        while (pointer < cumulative && selected.size() < n) {
+            selected.emplace_back(it);
+            pointer += step;
+        }
+    }
+    // Rounding errors can leave the last pointers just past the end
+    Iter last = std::next(begin, weights.size() - 1);
+    while (selected.size() < n) {
+        selected.emplace_back(last);
+    }
+
+    return selected;
+}
+
+/**
+ * Stochastic universal sampling as a selection function, to plug into `Genus::generate_new_individuals`.
+ *
+ * On the first draw from a species it samples `batch_size` (or species size, if zero) parents in one sweep and
+ * shuffles them, following draws just hand out the next parent of the batch. A new batch is sampled when the
+ * previous one is exhausted. Caching follows the same rules as `AliasSelection`: a long-lived instance needs a new
+ * token with `set_generation()` every time the populations change.
+ *
+ * Not thread safe, for the same reasons as `AliasSelection`: it must not be passed to the `Executor` overloads of
+ * `Genus::generate_new_individuals`.
+ *
+ * @tparam Fitness by default the adjusted fitness of a `Species::Indiv`
+ */
+template<typename F, typename Iter, typename std::optional<F> Fitness(Iter&) = indiv_adjusted_fitness<F, Iter>, typename RandomGenerator = std::mt19937>
+class SUSSelection {
+    struct Batch {
+        std::vector<Iter> selected;
+        size_t next = 0;
+        size_t population_size = 0;
+    };
+    RandomGenerator *g;
+    size_t batch_size;
+    uint64_t generation;
+    std::unordered_map<const void*, Batch> batches;
+public:
+    /**
+     * @param g random generator
+     * @param batch_size parents sampled in one sweep, the species size if zero
+     * @param generation token of the populations the batches are sampled from
+     */
+    explicit SUSSelection(RandomGenerator &g, size_t batch_size = 0, uint64_t generation = 0)
+            : g(&g), batch_size(batch_size), generation(generation) {}
+
+    Iter operator()(const Iter begin, const Iter end)
+    {
+        if (begin == end) throw std::invalid_argument("Source selection cannot be empty");
+        Batch &batch = batches[std::addressof(*begin)];
+        const size_t size = static_cast<size_t>(std::distance(begin, end));
+
+        if (batch.next >= batch.selected.size() || batch.population_size != size) {
+            size_t n = batch_size > 0 ? batch_size : size;
+            batch.selected = stochastic_universal_sampling<F, Iter, Fitness>(begin, end, n, *g);
+            std::shuffle(batch.selected.begin(), batch.selected.end(), *g);
+            batch.next = 0;
+            batch.population_size = size;
+        }
+
+        return batch.selected[batch.next++];
+    }
+
+    /**
+     * Moves to the populations identified by `token`, the sampled batches are forgotten if it's a new one.
+     */
+    void set_generation(uint64_t token)
+    {
+        if (token == generation) return;
+        generation = token;
+        batches.clear();
+    }
+
+    /**
+     * Forgets all sampled batches, to be called when the underlying populations change.
+     */
+    void reset() { batches.clear(); }
+};
+
 /**
  * Performs selection on a population of a distinct group, it can be used in the
  * form parent selection or survival selection.
@@ -0,0 +1,105 @@
+#ifndef SPECIATION_SHAREDINDIVIDUAL_H
+#define SPECIATION_SHAREDINDIVIDUAL_H
+
+#include <cassert>
+#include <memory>
+#include <utility>
+
+namespace speciation {
+
+/**
+ * Individual shared between generations, with copy-on-write.
+ *
+ * It's a reference counted handle to an individual `I`, with the interface of an individual itself: use
+ * `Genus<SharedIndividual<I>, F>` and the survivors and elites go in the next generation at no copy cost.
+ * `clone()` returns a new handle to the same individual, so `multiple_selection_no_duplicates`,
+ * `multiple_selection_with_duplicates`, population managements keeping the old individuals and the migrations of the
+ * `IslandModel` share the individuals instead of copying them.
+ *
+ * The individual is immutable while shared: `get_mutable()` copies it first (with `I::clone()`), only if another
+ * handle refers to it. A reproduction function can then return `parent.clone()` and let the mutation copy the genome
+ * only when it really changes it.
+ *
+ * The reference counting is thread safe, a single handle must not be used by different threads concurrently.
+ *
+ * @tparam I individual type, it must provide `I clone() const`
+ */
+template<typename I>
+class SharedIndividual {
+    std::shared_ptr<I> individual;
+
+public:
+    explicit SharedIndividual(I &&individual)
+            : individual(std::make_shared<I>(std::move(individual)))
+    {}
+
+    explicit SharedIndividual(std::shared_ptr<I> individual)
+            : individual(std::move(individual))
+    {
+        assert(this->individual);
+    }
+
+    SharedIndividual(const SharedIndividual &) = default;
+    SharedIndividual(SharedIndividual &&) noexcept = default;
+    SharedIndividual& operator=(const SharedIndividual &) = default;
+    SharedIndividual& operator=(SharedIndividual &&) noexcept = default;
+
+    // Individual interface, forwarded to the shared individual
+    [[nodiscard]] decltype(auto) fitness() const { return individual->fitness(); }
+
+    [[nodiscard]] bool is_compatible(const SharedIndividual &other) const
+    {
+        return individual->is_compatible(*other.individual);
+    }
+
+    /// Only if `I` implements `is_compatible(other, threshold)`
+    template<typename J = I>
+    [[nodiscard]] auto is_compatible(const SharedIndividual &other, double threshold) const
+            -> decltype(std::declval<const J&>().is_compatible(std::declval<const J&>(), threshold))
+    {
+        return individual->is_compatible(*other.individual, threshold);
+    }
+
+    /// Only if `I` implements `distance(other)`
+    template<typename J = I>
+    [[nodiscard]] auto distance(const SharedIndividual &other) const
+            -> decltype(std::declval<const J&>().distance(std::declval<const J&>()))
+    {
+        return individual->distance(*other.individual);
+    }
+
+    /// Only if `I` implements `sketch()`
+    template<typename J = I>
+    [[nodiscard]] auto sketch() const -> decltype(std::declval<const J&>().sketch())
+    {
+        return individual->sketch();
+    }
+
+    /**
+     * @return a new handle to the same individual, nothing is copied
+     */
+    [[nodiscard]] SharedIndividual clone() const { return SharedIndividual(*this); }
+
+    // Access
+    [[nodiscard]] const I& operator*() const { return *individual; }
+    [[nodiscard]] const I* operator->() const { return individual.get(); }
+    [[nodiscard]] const I* get() const { return individual.get(); }
+
+    /**
+     * Mutable access: the individual is copied first if it's shared with other handles (copy-on-write).
+     */
+    I& get_mutable()
+    {
+        if (individual.use_count() > 1)
+            individual = std::make_shared<I>(individual->clone());
+        return *individual;
+    }
+
+    /// True if other handles refer to the same individual
+    [[nodiscard]] bool is_shared() const { return individual.use_count() > 1; }
+    [[nodiscard]] long use_count() const { return individual.use_count(); }
+};
+
+}
+
+#endif //SPECIATION_SHAREDINDIVIDUAL_H
@@ -9,6 +9,9 @@
 #include <cassert>
 #include <memory>
 #include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <iostream>
 #include "Age.h"
@@ -17,6 +20,149 @@
 
 namespace speciation {
 
+namespace detail {
+template<typename I, typename = void>
+struct has_threshold_compatibility : std::false_type {};
+
+template<typename I>
+struct has_threshold_compatibility<I, std::void_t<decltype(
+        std::declval<const I&>().is_compatible(std::declval<const I&>(), std::declval<double>()))> >
+        : std::true_type {};
+
+template<typename I, typename = void>
+struct has_sketch : std::false_type {};
+
+template<typename I>
+struct has_sketch<I, std::void_t<decltype(std::declval<const I&>().sketch())> > : std::true_type {};
+
+/// Placeholder for the individuals without a sketch
+struct NoSketch {};
+
+template<typename I, bool = has_sketch<I>::value>
+struct sketch_of {
+    using type = NoSketch;
+};
+
+template<typename I>
+struct sketch_of<I, true> {
+    using type = std::decay_t<decltype(std::declval<const I&>().sketch())>;
+};
+
+template<typename S, typename = void>
+struct has_threshold_sketch : std::false_type {};
+
+template<typename S>
+struct has_threshold_sketch<S, std::void_t<decltype(
+        std::declval<const S&>().may_be_compatible(std::declval<const S&>(), std::declval<double>()))> >
+        : std::true_type {};
+
+template<typename S, typename = void>
+struct has_plain_sketch : std::false_type {};
+
+template<typename S>
+struct has_plain_sketch<S, std::void_t<decltype(
+        std::declval<const S&>().may_be_compatible(std::declval<const S&>()))> >
+        : std::true_type {};
+
+/// Prefilter for `is_compatible(other)` without threshold: only the sketches without threshold can tell
+template<typename S>
+bool sketch_may_be_compatible(const S &representative, const S &candidate)
+{
+    if constexpr (has_plain_sketch<S>::value) {
+        return representative.may_be_compatible(candidate);
+    } else {
+        (void) representative; (void) candidate;
+        return true;
+    }
+}
+
+template<typename S>
+bool sketch_may_be_compatible(const S &representative, const S &candidate, double compatibility_threshold)
+{
+    if constexpr (has_threshold_sketch<S>::value) {
+        return representative.may_be_compatible(candidate, compatibility_threshold);
+    } else {
+        (void) compatibility_threshold;
+        return representative.may_be_compatible(candidate);
+    }
+}
+
+template<typename I>
+bool exact_is_compatible(const I &representative, const I &candidate, double compatibility_threshold)
+{
+    if constexpr (has_threshold_compatibility<I>::value) {
+        return representative.is_compatible(candidate, compatibility_threshold);
+    } else {
+        (void) compatibility_threshold;
+        return representative.is_compatible(candidate);
+    }
+}
+
+template<typename I, typename = void>
+struct has_distance : std::false_type {};
+
+template<typename I>
+struct has_distance<I, std::void_t<decltype(std::declval<const I&>().distance(std::declval<const I&>()))> >
+        : std::true_type {};
+}
+
+/**
+ * Tests if two individuals are compatible, passing the compatibility threshold to the individuals that support it
+ * (see `IndividualPrototype::is_compatible`).
+ *
+ * Individuals with a sketch (see `IndividualPrototype`) are first compared by sketch, and `is_compatible` is called
+ * only if the sketches may be compatible.
+ */
+template<typename I>
+bool is_compatible(const I &representative, const I &candidate, double compatibility_threshold)
+{
+    if constexpr (detail::has_sketch<I>::value) {
+        if (!detail::sketch_may_be_compatible(representative.sketch(), candidate.sketch(), compatibility_threshold))
+            return false;
+    }
+    return detail::exact_is_compatible(representative, candidate, compatibility_threshold);
+}
+
+/**
+ * Distance between two individuals, for the individuals implementing `double distance(const I &other) const`.
+ * @throws std::logic_error if the individuals do not implement it
+ */
+template<typename I>
+double distance(const I &a, const I &b)
+{
+    if constexpr (detail::has_distance<I>::value) {
+        return static_cast<double>(a.distance(b));
+    } else {
+        (void) a; (void) b;
+        throw std::logic_error("The individuals must implement `double distance(const I &other) const` "
+                               "to use Conf::max_species");
+    }
+}
+
+/**
+ * Finds the species with the representative nearest to the individual (see `Conf::max_species`).
+ * @param n_species number of species
+ * @param representative_of representative of a species, nullptr for empty species
+ * @param individual the individual to place
+ * @return the index of the nearest species, `n_species` if all the species are empty
+ */
+template<typename I, typename RepresentativeOf>
+size_t nearest_species(size_t n_species, const RepresentativeOf &representative_of, const I &individual)
+{
+    size_t nearest = n_species;
+    double nearest_distance = std::numeric_limits<double>::infinity();
+    for (size_t s = 0; s < n_species; s++) {
+        const I *representative = representative_of(s);
+        if (representative == nullptr) continue;
+        const double d = speciation::distance(*representative, individual);
+        if (nearest == n_species || d < nearest_distance) {
+            nearest = s;
+            nearest_distance = d;
+        }
+    }
+    return nearest;
+}
+
 /**
  * Collection of individuals that are the same Species
  * I.e. they have compatible genomes and are considered similar individuals/solutions.
@@ -43,13 +189,24 @@ public:
                 : adjusted_fitness(other.adjusted_fitness)
                 , individual(std::move(other.individual))
         {};
+        Indiv& operator=(Indiv&& other) noexcept {
+            adjusted_fitness = other.adjusted_fitness;
+            individual = std::move(other.individual);
+            return *this;
+        }
     };
     using iterator = typename std::vector<Indiv>::iterator;
     using const_iterator = typename std::vector<Indiv>::const_iterator;
 private:
 
+    using Sketch = typename detail::sketch_of<I>::type;
+
     /// List of individuals and adjusted fitness
     std::vector<Indiv> individuals;
+    /// Copy of the representative sketch, kept inline for the compatibility prefilter
+    Sketch representative_sketch;
+    /// If `representative_sketch` is the sketch of the current representative, otherwise the prefilter is skipped
+    bool sketch_valid = false;
     /// Id of the species (conserved across generations)
     unsigned int _id;
     /// `Age` of this species
@@ -70,6 +227,7 @@ public:
             std::unique_ptr<I> &individual = *begin_population;
             this->individuals.emplace_back(std::move(individual));
         }
+        _update_sketch();
     }
 
     Species(std::unique_ptr<I> &&individual, int species_id)
@@ -78,6 +236,7 @@ public:
         , last_best_fitness(0.0)
     {
         this->individuals.emplace_back(std::move(individual));
+        _update_sketch();
     }
 
     Species() = delete;
@@ -87,6 +246,8 @@ public:
             , age(other.age)
             , last_best_fitness(0.0)
             , individuals(std::move(other.individuals))
+            , representative_sketch(std::move(other.representative_sketch))
+            , sketch_valid(std::exchange(other.sketch_valid, false))
     {}
 
     Species& operator=(const Species &) noexcept = delete;
@@ -96,6 +257,8 @@ public:
         age = other.age;
         last_best_fitness = other.last_best_fitness;
         individuals = std::move(other.individuals);
+        representative_sketch = std::move(other.representative_sketch);
+        sketch_valid = std::exchange(other.sketch_valid, false);
 
         other._id = 0;
         other.age = Age();
@@ -125,9 +288,32 @@ public:
     bool is_compatible(const I &candidate) const {
         if (this->empty())
             return false;
+        if constexpr (detail::has_sketch<I>::value) {
+            if (sketch_valid && !detail::sketch_may_be_compatible(representative_sketch, candidate.sketch()))
+                return false;
+        }
         return this->representative().is_compatible(candidate);
     }
 
+    /**
+     * Tets if the candidate individual is compatible with this Species, with a compatibility threshold
+     * @param candidate is the individual to test against the current species
+     * @param compatibility_threshold passed to the individuals that support it
+     * @return if the candidate individual is compatible or not
+     */
+    bool is_compatible(const I &candidate, double compatibility_threshold) const {
+        if (this->empty())
+            return false;
+        if constexpr (detail::has_sketch<I>::value) {
+            if (sketch_valid
+                && !detail::sketch_may_be_compatible(representative_sketch, candidate.sketch(),
+                                                     compatibility_threshold)) {
+                return false;
+            }
+        }
+        return detail::exact_is_compatible(this->representative(), candidate, compatibility_threshold);
+    }
+
     /**
      * Finds the best fitness for individuals in the species.
      * If the species is empty, it returns negative infinity.
@@ -168,6 +354,14 @@ public:
         return *individuals.front().individual;
     }
 
+    /**
+     * Copies again the sketch of the representative, to be called after changing the representative in place
+     * (through `individual(0)` or the iterators): the compatibility prefilter would use the old sketch otherwise.
+     */
+    void update_representative_sketch() {
+        _update_sketch();
+    }
+
     /**
      * This method performs fitness sharing. It computes the adjusted fitness of the individuals.
      * It also boosts the fitness of the young and penalizes old species.
@@ -199,6 +393,24 @@ public:
      */
     void insert(std::unique_ptr<I> &&individual) {
         this->individuals.emplace_back(std::move(individual));
+        // the first individual is the new representative
+        if (this->individuals.size() == 1)
+            _update_sketch();
+    }
+
+    /**
+     * Removes an individual from this species.
+     * The adjusted fitnesses of the remaining individuals are not updated.
+     *
+     * @param i index of the individual to remove
+     * @return the removed individual
+     */
+    std::unique_ptr<I> remove(size_t i) {
+        std::unique_ptr<I> removed = std::move(this->individuals.at(i).individual);
+        this->individuals.erase(this->individuals.begin() + i);
+        if (i == 0)
+            _update_sketch();
+        return removed;
     }
 
     /**
@@ -206,17 +418,13 @@ public:
      */
      void set_individuals(std::vector<std::unique_ptr<I> > &&new_individuals)
      {
-        std::cout << "set_individuals(this=" << id() << ')' << std::endl;
         individuals.clear();
-        std::cout << "set_individuals(this=" << id() << ") reserve" << std::endl;
         individuals.reserve(new_individuals.size());
         for (std::unique_ptr<I> &individual: new_individuals) {
-            std::cout << "set_individuals(individual=" << individual.get() << ") finished" << std::endl;
             individuals.emplace_back(std::move(individual));
         }
-        std::cout << "set_individuals(this=" << id() << ") shrink_to_fit" << std::endl;
         individuals.shrink_to_fit();
-        std::cout << "set_individuals(this=" << id() << ") finished" << std::endl;
+        _update_sketch();
      }
 
     iterator begin() {
@@ -284,6 +492,19 @@ private:
         return fitness;
     }
 
+    /**
+     * Copies the sketch of the (new) representative, for the individuals with a sketch.
+     * It's called every time the representative changes: `set_individuals`, `insert` in an empty species and
+     * `remove` of the representative.
+     */
+    void _update_sketch() {
+        if constexpr (detail::has_sketch<I>::value) {
+            sketch_valid = !individuals.empty() && individuals.front().individual;
+            if (sketch_valid)
+                representative_sketch = individuals.front().individual->sketch();
+        }
+    }
+
 public:
     // Relay functions
     [[nodiscard]] bool empty() const {
@@ -331,7 +552,7 @@ public:
     }
 
     // Operators
-    bool operator== (const Species<I,F> &other) const {
+    bool operator== (const Species &other) const {
         if (this->id != other.id or this->age != other.age) {
             return false;
         }
@@ -9,6 +9,7 @@
 #include <set>
 #include <numeric>
 #include "Species.h"
+#include "Executor.h"
 
 namespace speciation {
 
@@ -88,6 +89,23 @@ public:
         cache_need_updating = true;
     }
 
+    /**
+     * Inserts the individual in the first compatible species, if any.
+     * @param individual individual to insert, it is moved only if a compatible species is found.
+     * @param compatibility_threshold passed to the individuals that support it
+     * @return true if the individual was inserted
+     */
+    bool insert_in_compatible_species(std::unique_ptr<I> &individual, double compatibility_threshold) {
+        for (Species<I,F> &species : collection) {
+            if (species.is_compatible(*individual, compatibility_threshold)) {
+                species.insert(std::move(individual));
+                cache_need_updating = true;
+                return true;
+            }
+        }
+        return false;
+    }
+
     /**
      * Replaces the individuals of a species at index `species_index`.
      * @param species_index index of which species to operate on.
@@ -133,6 +151,19 @@ public:
         }
     }
 
+    /**
+     * Computes the adjusted fitness for all species, the species in parallel
+     * @param conf Species configuration object
+     * @param executor executor running the species
+     */
+    void compute_adjust_fitness(const Conf &conf, Executor &executor)
+    {
+        executor.parallel_for(collection.size(), [this, &conf](size_t species_i) {
+            iterator species = collection.begin() + species_i;
+            species->compute_adjust_fitness(species == best, conf);
+        });
+    }
+
     /**
      * Updates the best_species, increases age for all species
      *
@@ -201,7 +232,7 @@ public:
     const_iterator get_worst(size_t minimal_size, std::optional<std::set<unsigned int> > exclude_id_list = std::nullopt) const {
         assert(!collection.empty());
 
-        F worst_species_fitness = -std::numeric_limits<F>::infinity();
+        F worst_species_fitness = std::numeric_limits<F>::infinity();
         const_iterator worst_species = collection.end();
 
         for (const_iterator species = collection.begin(); species != collection.end(); species++) {
@@ -215,10 +246,9 @@ public:
                 continue;
             }
 
-            std::optional<F> species_fitness = species->get_best_fitness();
-            if (species_fitness < worst_species_fitness) {
-                assert(species_fitness.has_value());
-                worst_species_fitness = species_fitness.value();
+            F species_fitness = species->get_best_fitness().value_or(-std::numeric_limits<F>::infinity());
+            if (worst_species == collection.end() || species_fitness < worst_species_fitness) {
+                worst_species_fitness = species_fitness;
                 worst_species = species;
             }
         }
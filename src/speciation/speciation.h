@@ -8,6 +8,7 @@ template<typename F> class invalid_fitness;
 template<typename I, typename F> class Genus;
 template<typename I, typename F> class Species;
 template<typename I, typename F> class SpeciesCollection;
+template<typename I, typename F> class IslandModel;
 }
 
 #endif //SPECIATION_SPECIATION_H
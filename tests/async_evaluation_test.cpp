@@ -0,0 +1,108 @@
+#include <speciation/AsyncEvaluation.h>
+#include "catch2/catch.hpp"
+#include "test_individuals.h"
+
+#ifdef SPECIATION_HAS_COROUTINES
+
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Asynchronous evaluation with coroutines" "[async_evaluation]")
+{
+    std::vector<std::unique_ptr<ChildIndividual> > individuals;
+    std::vector<ChildIndividual *> pointers;
+    for (int i = 0; i < 1000; i++) {
+        individuals.emplace_back(std::make_unique<ChildIndividual>(i));
+        pointers.push_back(individuals.back().get());
+    }
+
+    std::atomic<int> in_flight(0);
+    std::atomic<int> max_in_flight(0);
+    auto evaluate = [&](ChildIndividual *indiv, speciation::EventLoop &loop) -> speciation::Task<float> {
+        int now = ++in_flight;
+        int observed = max_in_flight;
+        while (now > observed && !max_in_flight.compare_exchange_weak(observed, now)) {}
+
+        // waiting on "I/O" does not block the thread
+        co_await loop.sleep_for(20ms);
+
+        in_flight--;
+        float fitness = static_cast<float>(indiv->get_id());
+        indiv->set_fitness(fitness);
+        co_return fitness;
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    speciation::evaluate_async<float>(pointers.begin(), pointers.end(), evaluate, 2);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    for (auto &indiv : individuals) {
+        REQUIRE(indiv->fitness().value() == static_cast<float>(indiv->get_id()));
+    }
+    // all 1000 evaluations were waiting at the same time on 2 threads
+    REQUIRE(max_in_flight == 1000);
+    REQUIRE(elapsed < 5s);
+
+    // limited concurrency
+    max_in_flight = 0;
+    speciation::evaluate_async<float>(pointers.begin(), pointers.begin() + 100, evaluate, 2, 10);
+    REQUIRE(max_in_flight <= 20);
+}
+
+TEST_CASE("Asynchronous evaluation completed from another thread" "[async_evaluation]")
+{
+    std::vector<std::unique_ptr<ChildIndividual> > individuals;
+    std::vector<ChildIndividual *> pointers;
+    for (int i = 0; i < 50; i++) {
+        individuals.emplace_back(std::make_unique<ChildIndividual>(i));
+        pointers.push_back(individuals.back().get());
+    }
+
+    std::mutex threads_mutex;
+    std::vector<std::thread> io_threads;
+    auto evaluate = [&](ChildIndividual *indiv, speciation::EventLoop &loop) -> speciation::Task<float> {
+        speciation::Completion<float> result(loop);
+        {
+            // simulated simulator socket answering from its own thread
+            std::lock_guard<std::mutex> lock(threads_mutex);
+            io_threads.emplace_back([result, id = indiv->get_id()]() mutable {
+                std::this_thread::sleep_for(1ms);
+                result.set_value(static_cast<float>(id) * 2);
+            });
+        }
+        float fitness = co_await result;
+        indiv->set_fitness(fitness);
+        co_return fitness;
+    };
+
+    speciation::evaluate_async<float>(pointers.begin(), pointers.end(), evaluate, 3);
+    for (std::thread &t : io_threads) t.join();
+
+    for (auto &indiv : individuals) {
+        REQUIRE(indiv->fitness().value() == static_cast<float>(indiv->get_id() * 2));
+    }
+}
+
+TEST_CASE("Asynchronous evaluation propagates exceptions" "[async_evaluation]")
+{
+    std::vector<std::unique_ptr<ChildIndividual> > individuals;
+    std::vector<ChildIndividual *> pointers;
+    for (int i = 0; i < 10; i++) {
+        individuals.emplace_back(std::make_unique<ChildIndividual>(i));
+        pointers.push_back(individuals.back().get());
+    }
+
+    auto evaluate = [](ChildIndividual *indiv, speciation::EventLoop &loop) -> speciation::Task<float> {
+        co_await loop.schedule();
+        if (indiv->get_id() == 5) throw std::runtime_error("simulator failure");
+        indiv->set_fitness(1);
+        co_return 1.f;
+    };
+
+    REQUIRE_THROWS_AS(speciation::evaluate_async<float>(pointers.begin(), pointers.end(), evaluate, 2),
+                      std::runtime_error);
+}
+
+#endif
@@ -0,0 +1,193 @@
+#include <speciation/AsyncEvolution.h>
+#include <speciation/Selection.h>
+#include "catch2/catch.hpp"
+#include <atomic>
+#include <chrono>
+#include <set>
+
+namespace {
+
+/// OneMax individual, compatible when less than a quarter of the bits are different
+class BitIndividual {
+    std::vector<bool> genome;
+    std::optional<float> _fitness;
+public:
+    explicit BitIndividual(std::vector<bool> genome)
+        : genome(std::move(genome)), _fitness(std::nullopt)
+    {}
+
+    [[nodiscard]] std::optional<float> fitness() const
+    { return _fitness; }
+
+    [[nodiscard]] bool is_compatible(const BitIndividual &other) const
+    {
+        size_t distance = 0;
+        for (size_t i = 0; i < genome.size(); i++) {
+            if (genome[i] != other.genome[i]) distance++;
+        }
+        return distance < genome.size() / 4;
+    }
+
+    [[nodiscard]] BitIndividual clone() const
+    { return BitIndividual(*this); }
+
+    float evaluate()
+    {
+        _fitness = static_cast<float>(std::count(genome.begin(), genome.end(), true));
+        return _fitness.value();
+    }
+
+    void flip(size_t i)
+    { genome[i] = !genome[i]; }
+
+    [[nodiscard]] const std::vector<bool>& bits() const
+    { return genome; }
+};
+
+/// Compatible with the individuals with a value closer than the compatibility threshold
+class ValueIndividual {
+    int value;
+    std::optional<float> _fitness;
+public:
+    explicit ValueIndividual(int value) : value(value) {}
+
+    [[nodiscard]] std::optional<float> fitness() const { return _fitness; }
+    [[nodiscard]] bool is_compatible(const ValueIndividual &other) const { return is_compatible(other, 1.0); }
+    [[nodiscard]] bool is_compatible(const ValueIndividual &other, double threshold) const
+    { return distance(other) < threshold; }
+    [[nodiscard]] double distance(const ValueIndividual &other) const { return std::abs(value - other.value); }
+    [[nodiscard]] ValueIndividual clone() const { return ValueIndividual(*this); }
+
+    float evaluate()
+    {
+        _fitness = static_cast<float>(value);
+        return _fitness.value();
+    }
+
+    [[nodiscard]] int get_value() const { return value; }
+};
+
+}
+
+TEST_CASE("Asynchronous evolution species control" "[async]")
+{
+    speciation::Conf conf;
+    conf.total_population_size = 10;
+    conf.crossover = false;
+    conf.compatibility_threshold = 1;
+    conf.target_species = 1;
+    conf.compatibility_threshold_step = 1;
+    conf.max_compatibility_threshold = 3.5;
+    conf.max_species = 3;
+
+    std::vector<std::unique_ptr<ValueIndividual> > population;
+    for (int i = 0; i < 10; i++) {
+        population.emplace_back(std::make_unique<ValueIndividual>(i * 10));
+    }
+    auto evaluate = [](ValueIndividual *indiv) { return indiv->evaluate(); };
+
+    speciation::AsyncEvolution<ValueIndividual, float> evolution(conf, 2);
+    evolution.initialize(population.begin(), population.end(), evaluate);
+    // every value is its own species, but the cap is reached after 3
+    REQUIRE(evolution.size() == 3);
+    REQUIRE(evolution.get_compatibility_threshold() == 1);
+
+    std::mt19937 gen(0);
+    evolution.run(
+            [](auto begin, auto) { return begin; },
+            [](auto begin, auto) { return std::make_pair(begin, begin); },
+            [](const ValueIndividual &parent) { return std::make_unique<ValueIndividual>(parent.get_value() + 1); },
+            [](const ValueIndividual &parent, const ValueIndividual &) {
+                return std::make_unique<ValueIndividual>(parent.get_value());
+            },
+            [](ValueIndividual &) {},
+            evaluate, 100);
+
+    REQUIRE(evolution.size() <= conf.max_species);
+    // too many species for the target: the threshold grows, up to the maximum
+    REQUIRE(evolution.get_compatibility_threshold() == 3.5);
+}
+
+TEST_CASE("Asynchronous steady state evolution" "[async]")
+{
+    constexpr size_t genome_size = 24;
+    constexpr unsigned int population_size = 20;
+    std::mt19937 gen(0);
+
+    speciation::Conf conf;
+    conf.total_population_size = population_size;
+    conf.crossover = false;
+
+    std::vector<std::unique_ptr<BitIndividual> > population;
+    std::bernoulli_distribution bit(0.3);
+    for (unsigned int i = 0; i < population_size; i++) {
+        std::vector<bool> genome(genome_size);
+        for (size_t b = 0; b < genome_size; b++) genome[b] = bit(gen);
+        population.emplace_back(std::make_unique<BitIndividual>(genome));
+    }
+
+    std::atomic<size_t> evaluations(0);
+    auto evaluate = [&evaluations](BitIndividual *indiv) {
+        // uneven evaluation times
+        const size_t n = evaluations++;
+        std::this_thread::sleep_for(std::chrono::microseconds((n % 7) * 50));
+        return indiv->evaluate();
+    };
+
+    speciation::AsyncEvolution<BitIndividual, float> evolution(conf, 4);
+    REQUIRE_THROWS_AS(evolution.run(nullptr, nullptr, nullptr, nullptr, nullptr, evaluate, 1), std::logic_error);
+
+    evolution.initialize(population.begin(), population.end(), evaluate);
+    REQUIRE(evaluations == population_size);
+    REQUIRE(evolution.count_individuals() == population_size);
+    REQUIRE(evolution.evaluations() == 0);
+    const float initial_best = evolution.best_fitness().value();
+
+    auto selection = [&gen](auto begin, auto end) {
+        return speciation::tournament_selection<float>(begin, end, gen, 3);
+    };
+    auto parent_selection = [](auto begin, auto end) {
+        return std::make_pair(begin, begin);
+    };
+    auto reproduce = [](const BitIndividual &parent) {
+        return std::make_unique<BitIndividual>(parent.bits());
+    };
+    auto crossover = [](const BitIndividual &a, const BitIndividual &) {
+        return std::make_unique<BitIndividual>(a.bits());
+    };
+    auto mutate = [&gen](BitIndividual &indiv) {
+        std::uniform_int_distribution<size_t> dis(0, genome_size - 1);
+        indiv.flip(dis(gen));
+    };
+
+    evolution.run(selection, parent_selection, reproduce, crossover, mutate, evaluate, 2000);
+
+    REQUIRE(evolution.evaluations() == 2000);
+    REQUIRE(evaluations == population_size + 2000);
+    REQUIRE(evolution.count_individuals() == population_size);
+    REQUIRE(evolution.best_fitness().value() > initial_best);
+
+    std::set<unsigned int> ids;
+    for (const speciation::Species<BitIndividual, float> &species : evolution) {
+        REQUIRE_FALSE(species.empty());
+        REQUIRE(ids.insert(species.id()).second);
+    }
+}
+
+TEST_CASE("Asynchronous evolution propagates evaluation errors" "[async]")
+{
+    speciation::Conf conf;
+    conf.total_population_size = 4;
+
+    std::vector<std::unique_ptr<BitIndividual> > population;
+    for (int i = 0; i < 4; i++) {
+        population.emplace_back(std::make_unique<BitIndividual>(std::vector<bool>(8, false)));
+    }
+
+    speciation::AsyncEvolution<BitIndividual, float> evolution(conf, 2);
+    REQUIRE_THROWS_AS(
+            evolution.initialize(population.begin(), population.end(), [](BitIndividual *) -> float {
+                throw std::runtime_error("evaluation failure");
+            }),
+            std::runtime_error);
+}
@@ -41,13 +41,15 @@ TEST_CASE( "Instantiate a derived conf and use it", "[conf]" )
     REQUIRE(initial_population.size() == genus.count_individuals());
 
     const ExtendedConf conf {
-        static_cast<unsigned int>(initial_population.size()),
-        true,
-        2,
-        10,
-        20,
-        1.1,
-        0.9,
+        {
+            static_cast<unsigned int>(initial_population.size()),
+            true,
+            2,
+            10,
+            20,
+            1.1,
+            0.9,
+        },
         std::nullopt,
     };
 
@@ -0,0 +1,189 @@
+#include <speciation/DeltaIndividual.h>
+#include <speciation/Genus.h>
+#include <speciation/Individual.h>
+#include "catch2/catch.hpp"
+#include "test_individuals.h"
+
+#include <numeric>
+#include <random>
+#include <set>
+
+using speciation::DeltaIndividual;
+
+namespace {
+
+/// Large genome, counting the deep copies
+class Genome {
+    std::vector<int> genes;
+
+public:
+    static int copies;
+
+    explicit Genome(int value) : genes(1000, value) {}
+
+    [[nodiscard]] bool is_compatible(const Genome &other) const { return group() == other.group(); }
+    [[nodiscard]] double distance(const Genome &other) const { return std::abs(group() - other.group()); }
+    [[nodiscard]] Genome clone() const
+    {
+        copies++;
+        return *this;
+    }
+
+    [[nodiscard]] int gene(size_t i) const { return genes[i]; }
+    void add(size_t i, int value) { genes[i] += value; }
+    [[nodiscard]] int group() const { return genes[0] / 100; }
+    [[nodiscard]] int sum() const { return std::accumulate(genes.begin(), genes.end(), 0); }
+};
+
+int Genome::copies = 0;
+
+/// Adds a value to a gene
+struct AddDelta {
+    size_t gene;
+    int value;
+
+    void apply(Genome &genome) const { genome.add(gene, value); }
+};
+
+using Delta = DeltaIndividual<Genome, AddDelta, float>;
+
+}
+
+TEST_CASE("Delta individual materialization" "[delta]")
+{
+    static_assert(speciation::is_individual_v<Delta, float>, "DeltaIndividual is an individual");
+    static_assert(speciation::detail::has_distance<Delta>::value, "distance is forwarded");
+
+    Genome::copies = 0;
+    Delta parent(Genome(7));
+    parent.set_fitness(1.f);
+
+    Delta child = parent.clone();
+    REQUIRE(child.fitness() == 1.f);
+    child.mutate({3, 5});
+    child.mutate({3, 1});
+    child.mutate({10, -2});
+    REQUIRE_FALSE(child.fitness().has_value());
+    REQUIRE(child.delta_count() == 3);
+    REQUIRE(child.base_genome() == parent.base_genome());
+    REQUIRE(Genome::copies == 0);
+
+    // the parent is alive: the materialized genome is a temporary copy
+    {
+        std::shared_ptr<const Genome> genome = child.genome();
+        REQUIRE(Genome::copies == 1);
+        REQUIRE(genome->gene(3) == 13);
+        REQUIRE(genome->gene(10) == 5);
+        REQUIRE(genome->sum() == 7 * 1000 + 4);
+    }
+    REQUIRE(child.delta_count() == 3);
+    REQUIRE(parent.genome()->gene(3) == 7);
+    REQUIRE(Genome::copies == 1);
+
+    // the grandchild refers to the same ancestor, with all the mutations
+    Delta grandchild = child.clone();
+    grandchild.mutate({0, 100});
+    REQUIRE(grandchild.base_genome() == parent.base_genome());
+    REQUIRE(grandchild.genome()->gene(0) == 107);
+    REQUIRE(grandchild.genome()->gene(3) == 13);
+    REQUIRE(child.genome()->gene(3) == 13);
+    REQUIRE(Genome::copies == 4);
+    REQUIRE(child.is_compatible(parent));
+    REQUIRE_FALSE(grandchild.is_compatible(parent));
+    REQUIRE(grandchild.distance(parent) == 1.);
+
+    // a candidate sharing its ancestor is copied by every check, unless it's compacted
+    Delta candidate = parent.clone();
+    candidate.mutate({0, 100});
+    Genome::copies = 0;
+    REQUIRE_FALSE(parent.is_compatible(candidate));
+    REQUIRE(parent.distance(candidate) == 1.);
+    REQUIRE(Genome::copies == 2);
+    candidate.compact();
+    REQUIRE_FALSE(parent.is_compatible(candidate));
+    REQUIRE(parent.distance(candidate) == 1.);
+    REQUIRE(Genome::copies == 3);
+}
+
+TEST_CASE("Delta individual compaction" "[delta]")
+{
+    Genome::copies = 0;
+    auto parent = std::make_unique<Delta>(Genome(0));
+    Delta child = parent->clone();
+    child.mutate({0, 1});
+
+    // the parent dies: the last child applies its mutations in place, without copies
+    parent.reset();
+    const Genome *ancestor = child.base_genome();
+    REQUIRE(child.genome()->gene(0) == 1);
+    REQUIRE(child.delta_count() == 0);
+    REQUIRE(child.base_genome() == ancestor);
+    REQUIRE(Genome::copies == 0);
+
+    // too many mutations: the genome is materialized and the ancestor released
+    Delta limited(Genome(0), 2);
+    Delta sibling = limited.clone();
+    sibling.mutate({0, 1});
+    sibling.mutate({0, 1});
+    REQUIRE(sibling.delta_count() == 2);
+    sibling.mutate({0, 1});
+    REQUIRE(sibling.delta_count() == 0);
+    REQUIRE(sibling.base_genome() != limited.base_genome());
+    REQUIRE(sibling.genome()->gene(0) == 3);
+    REQUIRE(limited.genome()->gene(0) == 0);
+    REQUIRE(Genome::copies == 1);
+}
+
+TEST_CASE("Genus with delta encoded offspring" "[delta]")
+{
+    speciation::Conf conf;
+    conf.total_population_size = 40;
+    conf.crossover = false;
+
+    std::vector<std::unique_ptr<Delta> > population;
+    for (int i = 0; i < 40; i++) {
+        population.emplace_back(std::make_unique<Delta>(Genome((i % 2) * 100)));
+    }
+    speciation::Genus<Delta, float> genus;
+    genus.speciate(population.begin(), population.end(), conf);
+    REQUIRE(genus.size() == 2);
+
+    auto evaluate = [](Delta *individual) {
+        const float fitness = static_cast<float>(individual->genome()->sum() % 1000);
+        individual->set_fitness(fitness);
+        return fitness;
+    };
+
+    // the old individuals die, releasing their genomes
+    auto population_manager = [](std::vector<std::unique_ptr<Delta> > &&new_individuals,
+                                 const std::vector<const Delta *> &,
+                                 unsigned int target_population) {
+        new_individuals.resize(target_population);
+        return std::move(new_individuals);
+    };
+
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<size_t> gene(1, 999);
+    for (int generation = 0; generation < 5; generation++) {
+        genus.ensure_evaluated_population(evaluate);
+        genus.update(conf);
+        speciation::GenusSeed seed = generate_from_first_individual(
+                genus, conf,
+                [](const Delta &parent) { return std::make_unique<Delta>(parent.clone()); },
+                [&](Delta &child) { child.mutate({gene(gen), 1}); });
+        seed.evaluate(evaluate);
+        genus = genus.next_generation(conf, std::move(seed), population_manager);
+        REQUIRE(genus.count_individuals() == conf.total_population_size);
+    }
+
+    // the population shares a few full genomes
+    std::set<const Genome *> bases;
+    for (const speciation::Species<Delta, float> &species : genus.get_species_collection()) {
+        for (const auto &indiv : species) {
+            const Delta &individual = *indiv.individual;
+            bases.insert(individual.base_genome());
+            REQUIRE(individual.genome()->sum() % 1000 == individual.fitness().value());
+        }
+    }
+    REQUIRE(bases.size() < conf.total_population_size / 4);
+}
@@ -157,7 +157,7 @@ TEST_CASE("Test evolutionary run" "[integration]")
     std::vector<std::unique_ptr<Individual> > initial_population;
     initial_population.reserve(POPULATION_SIZE);
 
-    std::mt19937 gen(0);
+    std::mt19937 gen(1);
 
     for (size_t i=0; i<initial_population.capacity(); i++) {
         initial_population.emplace_back(std::make_unique<Individual>(i, GENOME_SIZE, gen));
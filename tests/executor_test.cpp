@@ -0,0 +1,57 @@
+#include <speciation/Executor.h>
+#include "catch2/catch.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace speciation;
+
+TEST_CASE("Sequential executor" "[executor]")
+{
+    SequentialExecutor executor;
+    REQUIRE(executor.concurrency() == 1);
+    std::vector<size_t> order;
+    executor.parallel_for(5, [&order](size_t i) { order.emplace_back(i); });
+    REQUIRE(order == std::vector<size_t>{0, 1, 2, 3, 4});
+}
+
+TEST_CASE("Work stealing executor" "[executor]")
+{
+    WorkStealingExecutor executor(4);
+    REQUIRE(executor.concurrency() == 4);
+
+    std::vector<std::atomic<int> > runs(1000);
+    executor.parallel_for(runs.size(), [&runs](size_t i) { runs[i]++; });
+    for (std::atomic<int> &run : runs) REQUIRE(run == 1);
+    executor.parallel_for(0, [](size_t) { throw std::logic_error("never called"); });
+
+    // nested: unbalanced outer tasks, the inner ones are stolen by the idle workers
+    std::vector<std::atomic<int> > inner_runs(50 * 49 / 2);
+    executor.parallel_for(50, [&](size_t outer) {
+        executor.parallel_for(outer, [&](size_t inner) {
+            inner_runs[outer * (outer - 1) / 2 + inner]++;
+        });
+    });
+    for (std::atomic<int> &run : inner_runs) REQUIRE(run == 1);
+
+    // concurrent callers outside of the pool
+    std::atomic<size_t> sum(0);
+    std::vector<std::thread> callers;
+    for (int c = 0; c < 4; c++) {
+        callers.emplace_back([&]() {
+            executor.parallel_for(100, [&sum](size_t i) { sum += i; });
+        });
+    }
+    for (std::thread &caller : callers) caller.join();
+    REQUIRE(sum == 4 * 99 * 100 / 2);
+
+    // the first exception is rethrown, the pool is still usable
+    REQUIRE_THROWS_AS(executor.parallel_for(100, [](size_t i) {
+        if (i == 42) throw std::runtime_error("task failed");
+    }), std::runtime_error);
+    std::atomic<size_t> count(0);
+    executor.parallel_for(100, [&count](size_t) { count++; });
+    REQUIRE(count == 100);
+}
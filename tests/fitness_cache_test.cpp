@@ -0,0 +1,109 @@
+#include <speciation/FitnessCache.h>
+#include <speciation/Genus.h>
+#include "catch2/catch.hpp"
+#include "test_individuals.h"
+#include <atomic>
+#include <thread>
+
+TEST_CASE("Fitness cache hits and misses" "[cache]")
+{
+    speciation::FitnessCache<std::vector<bool>, float> cache(8, 1);
+    REQUIRE(cache.capacity() == 8);
+
+    std::vector<bool> genome_a = {true, false, true};
+    std::vector<bool> genome_b = {true, true, true};
+
+    REQUIRE_FALSE(cache.find(genome_a).has_value());
+    cache.insert(genome_a, 2);
+    REQUIRE(cache.find(genome_a).value() == 2);
+    REQUIRE_FALSE(cache.find(genome_b).has_value());
+
+    REQUIRE(cache.hits() == 1);
+    REQUIRE(cache.misses() == 2);
+    REQUIRE(cache.hit_rate() == Approx(1. / 3.));
+    REQUIRE(cache.size() == 1);
+
+    cache.clear();
+    REQUIRE(cache.size() == 0);
+    REQUIRE_FALSE(cache.find(genome_a).has_value());
+}
+
+TEST_CASE("Fitness cache evicts with CLOCK" "[cache]")
+{
+    speciation::FitnessCache<int, float> cache(4, 1);
+    for (int i = 0; i < 4; i++) cache.insert(i, static_cast<float>(i));
+    REQUIRE(cache.size() == 4);
+
+    // 0 and 2 are recently used, they get a second chance
+    REQUIRE(cache.find(0).has_value());
+    REQUIRE(cache.find(2).has_value());
+
+    cache.insert(10, 10);
+    cache.insert(11, 11);
+    REQUIRE(cache.size() == 4);
+    REQUIRE(cache.evictions() == 2);
+    REQUIRE(cache.find(0).has_value());
+    REQUIRE(cache.find(2).has_value());
+    REQUIRE_FALSE(cache.find(1).has_value());
+    REQUIRE_FALSE(cache.find(3).has_value());
+    REQUIRE(cache.find(10).has_value());
+    REQUIRE(cache.find(11).has_value());
+}
+
+TEST_CASE("Fitness cache is thread safe" "[cache]")
+{
+    speciation::FitnessCache<int, float> cache(1000, 8);
+    std::atomic<int> wrong_values(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&cache, &wrong_values, t]() {
+            for (int i = 0; i < 5000; i++) {
+                int key = (i * 7 + t) % 2000;
+                std::optional<float> cached = cache.find(key);
+                if (cached.has_value()) {
+                    // Catch assertions are not thread safe
+                    if (cached.value() != static_cast<float>(key)) wrong_values++;
+                } else {
+                    cache.insert(key, static_cast<float>(key));
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads) thread.join();
+
+    REQUIRE(wrong_values == 0);
+    REQUIRE(cache.size() <= cache.capacity());
+    REQUIRE(cache.hits() + cache.misses() == 4 * 5000);
+}
+
+TEST_CASE("Fitness cache in front of the evaluation" "[cache]")
+{
+    speciation::Genus<ChildIndividual,float> genus;
+    std::vector<std::unique_ptr<ChildIndividual>> population;
+    for (int i = 0; i < 30; i++) {
+        population.emplace_back(std::make_unique<ChildIndividual>(i));
+    }
+    genus.speciate(population.begin(), population.end());
+
+    // individuals with the same id % 5 have the same "genome"
+    unsigned int evaluations = 0;
+    speciation::FitnessCache<int, float> cache(100);
+    auto evaluate = cache.wrap<ChildIndividual>(
+            [&evaluations](ChildIndividual *indiv) {
+                evaluations++;
+                float fitness = static_cast<float>(indiv->get_id() % 5);
+                indiv->set_fitness(fitness);
+                return fitness;
+            },
+            [](const ChildIndividual &indiv) { return indiv.get_id() % 5; },
+            [](ChildIndividual &indiv, float fitness) { indiv.set_fitness(fitness); });
+
+    genus.ensure_evaluated_population(evaluate);
+
+    REQUIRE(evaluations == 5);
+    REQUIRE(cache.hits() == 25);
+    REQUIRE(cache.misses() == 5);
+    for (const ChildIndividual *indiv : genus.best_individuals(30)) {
+        REQUIRE(indiv->fitness().value() == static_cast<float>(indiv->get_id() % 5));
+    }
+}
@@ -0,0 +1,206 @@
+#include <speciation/FitnessStore.h>
+#include <speciation/Genus.h>
+#include "catch2/catch.hpp"
+#include "test_individuals.h"
+
+#ifdef SPECIATION_HAS_FITNESS_STORE
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+/// Temporary store file, removed at the end of the test
+struct TemporaryFile {
+    std::string path;
+    TemporaryFile()
+    {
+        char name[] = "/tmp/speciation_fitness_store_XXXXXX";
+        int fd = mkstemp(name);
+        REQUIRE(fd >= 0);
+        close(fd);
+        path = name;
+        // the store creates the file itself
+        std::remove(path.c_str());
+    }
+    ~TemporaryFile() { std::remove(path.c_str()); }
+};
+
+uint64_t hash_id(const ChildIndividual &indiv)
+{
+    const int id = indiv.get_id();
+    return speciation::fnv1a_64(&id, sizeof(id));
+}
+
+}
+
+TEST_CASE("Fitness store persists fitnesses" "[store]")
+{
+    TemporaryFile file;
+    {
+        speciation::FitnessStore<float> store(file.path);
+        REQUIRE(store.size() == 0);
+        REQUIRE_FALSE(store.find(1).has_value());
+        store.insert(1, 1.5f);
+        store.insert(2, 2.5f);
+        // already present: nothing appended
+        store.insert(1, 100.f);
+        REQUIRE(store.find(1).value() == 1.5f);
+        store.sync();
+    }
+
+    speciation::FitnessStore<float> read_only(file.path, speciation::FitnessStore<float>::Mode::ReadOnly);
+    REQUIRE(read_only.size() == 2);
+    REQUIRE(read_only.find(1).value() == 1.5f);
+    REQUIRE(read_only.find(2).value() == 2.5f);
+    REQUIRE_FALSE(read_only.find(3).has_value());
+    REQUIRE(read_only.hits() == 2);
+    REQUIRE(read_only.misses() == 1);
+    REQUIRE_THROWS_AS(read_only.insert(3, 3.f), std::logic_error);
+}
+
+TEST_CASE("Fitness store sees records appended by other writers" "[store]")
+{
+    TemporaryFile file;
+    speciation::FitnessStore<double> writer(file.path);
+    speciation::FitnessStore<double> reader(file.path, speciation::FitnessStore<double>::Mode::ReadOnly);
+
+    writer.insert(42, 4.2);
+    REQUIRE_FALSE(reader.find(42).has_value());
+    REQUIRE(reader.refresh() == 1);
+    REQUIRE(reader.find(42).value() == 4.2);
+    REQUIRE(reader.refresh() == 0);
+
+    // a second writer on the same file
+    speciation::FitnessStore<double> other_writer(file.path);
+    REQUIRE(other_writer.find(42).value() == 4.2);
+    other_writer.insert(7, 0.7);
+    REQUIRE(writer.refresh() == 1);
+    REQUIRE(writer.find(7).value() == 0.7);
+}
+
+TEST_CASE("Fitness store concurrent creation" "[store]")
+{
+    TemporaryFile file;
+    constexpr unsigned int n_writers = 8;
+    std::vector<std::thread> writers;
+    for (unsigned int i = 0; i < n_writers; i++) {
+        writers.emplace_back([&file, i]() {
+            speciation::FitnessStore<float> store(file.path);
+            store.insert(i, static_cast<float>(i));
+        });
+    }
+    for (std::thread &writer : writers) writer.join();
+
+    // a single header, followed by one record per writer
+    speciation::FitnessStore<float> store(file.path, speciation::FitnessStore<float>::Mode::ReadOnly);
+    REQUIRE(store.size() == n_writers);
+    for (unsigned int i = 0; i < n_writers; i++) {
+        REQUIRE(store.find(i).value() == static_cast<float>(i));
+    }
+}
+
+TEST_CASE("Fitness store ignores truncated records" "[store]")
+{
+    TemporaryFile file;
+    {
+        speciation::FitnessStore<float> store(file.path);
+        store.insert(1, 1.f);
+    }
+    {
+        // half written record, as left by a crashed writer
+        std::ofstream out(file.path, std::ios::binary | std::ios::app);
+        const char garbage[5] = {1, 2, 3, 4, 5};
+        out.write(garbage, sizeof(garbage));
+    }
+
+    speciation::FitnessStore<float> store(file.path, speciation::FitnessStore<float>::Mode::ReadOnly);
+    REQUIRE(store.size() == 1);
+    REQUIRE(store.find(1).value() == 1.f);
+}
+
+TEST_CASE("Fitness store appends after a truncated record" "[store]")
+{
+    TemporaryFile file;
+    auto write_partial_record = [&file]() {
+        std::ofstream out(file.path, std::ios::binary | std::ios::app);
+        const char garbage[5] = {1, 2, 3, 4, 5};
+        out.write(garbage, sizeof(garbage));
+    };
+
+    speciation::FitnessStore<float> first(file.path);
+    first.insert(1, 1.f);
+    write_partial_record();
+
+    // cut off when the store is opened
+    speciation::FitnessStore<float> second(file.path);
+    second.insert(2, 2.f);
+    write_partial_record();
+
+    // cut off before appending, by a store opened earlier
+    first.insert(3, 3.f);
+    REQUIRE(first.refresh() == 1);
+    REQUIRE(first.find(2).value() == 2.f);
+
+    speciation::FitnessStore<float> store(file.path, speciation::FitnessStore<float>::Mode::ReadOnly);
+    REQUIRE(store.size() == 3);
+    REQUIRE(store.find(1).value() == 1.f);
+    REQUIRE(store.find(2).value() == 2.f);
+    REQUIRE(store.find(3).value() == 3.f);
+}
+
+TEST_CASE("Fitness store rejects incompatible files" "[store]")
+{
+    TemporaryFile file;
+    {
+        speciation::FitnessStore<float> store(file.path);
+        store.insert(1, 1.f);
+    }
+    REQUIRE_THROWS_AS(speciation::FitnessStore<double>(file.path), std::runtime_error);
+    REQUIRE_THROWS_AS(speciation::FitnessStore<float>(file.path + ".missing",
+                                                      speciation::FitnessStore<float>::Mode::ReadOnly),
+                      std::runtime_error);
+}
+
+TEST_CASE("Fitness store replays an evaluation" "[store]")
+{
+    TemporaryFile file;
+    auto evaluate_population = [&file](unsigned int &evaluations) {
+        speciation::Genus<ChildIndividual,float> genus;
+        std::vector<std::unique_ptr<ChildIndividual>> population;
+        for (int i = 0; i < 20; i++) {
+            population.emplace_back(std::make_unique<ChildIndividual>(i));
+        }
+        genus.speciate(population.begin(), population.end());
+
+        speciation::FitnessStore<float> store(file.path);
+        auto evaluate = store.wrap<ChildIndividual>(
+                [&evaluations](ChildIndividual *indiv) {
+                    evaluations++;
+                    float fitness = static_cast<float>(indiv->get_id()) / 2.f;
+                    indiv->set_fitness(fitness);
+                    return fitness;
+                },
+                hash_id,
+                [](ChildIndividual &indiv, float fitness) { indiv.set_fitness(fitness); });
+        genus.ensure_evaluated_population(evaluate);
+
+        for (const ChildIndividual *indiv : genus.best_individuals(20)) {
+            REQUIRE(indiv->fitness().value() == static_cast<float>(indiv->get_id()) / 2.f);
+        }
+    };
+
+    unsigned int first_run = 0;
+    evaluate_population(first_run);
+    REQUIRE(first_run == 20);
+
+    // the replay reads every fitness back from the store
+    unsigned int replay = 0;
+    evaluate_population(replay);
+    REQUIRE(replay == 0);
+}
+
+#endif // SPECIATION_HAS_FITNESS_STORE
@@ -0,0 +1,188 @@
+#include <speciation/GenomeArena.h>
+#include <speciation/Genus.h>
+#include <speciation/Selection.h>
+#include "catch2/catch.hpp"
+
+#ifdef SPECIATION_HAS_GENOME_ARENA
+
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <thread>
+
+using speciation::GenomeArena;
+
+namespace {
+
+std::string temporary_path()
+{
+    char name[] = "/tmp/speciation_genome_arena_XXXXXX";
+    int fd = mkstemp(name);
+    REQUIRE(fd >= 0);
+    close(fd);
+    return name;
+}
+
+/// Individual with the genome in the arena, speciation uses only its group (in memory)
+class ArenaIndividual {
+    GenomeArena *arena;
+    GenomeArena::Handle genome;
+    int group;
+    std::optional<float> _fitness;
+
+public:
+    ArenaIndividual(GenomeArena &arena, const std::vector<uint32_t> &genome, int group)
+            : arena(&arena), genome(arena.write(genome)), group(group) {}
+
+    [[nodiscard]] std::optional<float> fitness() const { return _fitness; }
+    [[nodiscard]] bool is_compatible(const ArenaIndividual &other) const { return group == other.group; }
+    [[nodiscard]] ArenaIndividual clone() const { return *this; }
+
+    float evaluate()
+    {
+        GenomeArena::View view = arena->read(genome);
+        const uint32_t *values = view.as<uint32_t>();
+        _fitness = static_cast<float>(std::accumulate(values, values + view.size() / sizeof(uint32_t), 0u));
+        return _fitness.value();
+    }
+
+    [[nodiscard]] ArenaIndividual crossover(const ArenaIndividual &other) const
+    {
+        std::vector<uint32_t> child = arena->read_vector<uint32_t>(genome);
+        std::vector<uint32_t> other_genome = arena->read_vector<uint32_t>(other.genome);
+        std::copy(other_genome.begin() + other_genome.size() / 2, other_genome.end(), child.begin() + child.size() / 2);
+        return ArenaIndividual(*arena, child, group);
+    }
+};
+
+}
+
+TEST_CASE("Genome arena stores payloads" "[arena]")
+{
+    const std::string path = temporary_path();
+    GenomeArena arena(path);
+    // the file is unlinked
+    REQUIRE(access(path.c_str(), F_OK) != 0);
+
+    std::vector<uint32_t> genome(100000);
+    std::iota(genome.begin(), genome.end(), 0u);
+    GenomeArena::Handle a = arena.write(genome);
+    GenomeArena::Handle b = arena.write("abc", 3);
+    GenomeArena::Handle empty = arena.write(nullptr, 0);
+    REQUIRE(a.size() == genome.size() * sizeof(uint32_t));
+    REQUIRE(arena.bytes_written() == a.size() + 3);
+
+    REQUIRE(arena.read_vector<uint32_t>(a) == genome);
+    {
+        GenomeArena::View view = arena.read(b);
+        REQUIRE(std::string(view.begin(), view.end()) == "abc");
+        GenomeArena::View moved = std::move(view);
+        REQUIRE(moved.size() == 3);
+        REQUIRE(view.size() == 0);
+    }
+    REQUIRE(arena.read(empty).size() == 0);
+    REQUIRE(arena.reads() == 3);
+
+    GenomeArena other(temporary_path());
+    REQUIRE_THROWS_AS(other.read(a), std::invalid_argument);
+    REQUIRE_THROWS_AS(arena.read(GenomeArena::Handle()), std::invalid_argument);
+}
+
+TEST_CASE("Genome arena reuses released payloads" "[arena]")
+{
+    GenomeArena arena(temporary_path());
+    std::vector<uint32_t> genome(10000, 7);
+
+    GenomeArena::Handle a = arena.write(genome);
+    GenomeArena::Handle copy = a;
+    const uint64_t file_size = arena.file_size();
+    REQUIRE(arena.live_bytes() == file_size);
+
+    // shared payload: still alive
+    a = GenomeArena::Handle();
+    REQUIRE(arena.read_vector<uint32_t>(copy) == genome);
+
+    copy = GenomeArena::Handle();
+    REQUIRE(arena.live_bytes() == 0);
+    GenomeArena::Handle c = arena.write(std::vector<uint32_t>(5000, 3));
+    REQUIRE(arena.file_size() == file_size);
+    REQUIRE(arena.read_vector<uint32_t>(c) == std::vector<uint32_t>(5000, 3));
+
+    // concurrent writers
+    std::vector<std::thread> writers;
+    std::vector<GenomeArena::Handle> handles(8);
+    for (uint32_t t = 0; t < handles.size(); t++) {
+        writers.emplace_back([&arena, &handles, t]() {
+            handles[t] = arena.write(std::vector<uint32_t>(3000 + t, t));
+        });
+    }
+    for (std::thread &writer : writers) writer.join();
+    for (uint32_t t = 0; t < handles.size(); t++) {
+        REQUIRE(arena.read_vector<uint32_t>(handles[t]) == std::vector<uint32_t>(3000 + t, t));
+    }
+}
+
+TEST_CASE("Genus with genomes in the arena" "[arena]")
+{
+    GenomeArena arena(temporary_path());
+    std::vector<std::unique_ptr<ArenaIndividual>> population;
+    for (uint32_t i = 0; i < 20; i++) {
+        population.emplace_back(std::make_unique<ArenaIndividual>(arena, std::vector<uint32_t>(1000, i), i % 2));
+    }
+
+    const uint64_t genome_capacity = arena.file_size() / 20;
+
+    speciation::Conf conf;
+    conf.total_population_size = 20;
+    speciation::Genus<ArenaIndividual, float> genus;
+    genus.speciate(population.begin(), population.end());
+    auto evaluate = [](ArenaIndividual *individual) { return individual->evaluate(); };
+    genus.ensure_evaluated_population(evaluate);
+    REQUIRE(arena.reads() == 20);
+
+    // speciation and selection: only in-memory metadata
+    std::mt19937 gen(0);
+    genus.update(conf);
+    REQUIRE(arena.reads() == 20);
+
+    auto generate = [&gen, &conf](const speciation::Genus<ArenaIndividual, float> &parents) {
+        return parents.generate_new_individuals(
+                conf,
+                [&gen](auto begin, auto end) { return speciation::tournament_selection<float>(begin, end, gen, 2); },
+                [](auto begin, auto) { return std::make_pair(begin, begin + 1); },
+                [](const ArenaIndividual &parent) { return std::make_unique<ArenaIndividual>(parent.clone()); },
+                [](const ArenaIndividual &a, const ArenaIndividual &b) {
+                    return std::make_unique<ArenaIndividual>(a.crossover(b));
+                },
+                [](ArenaIndividual &) {});
+    };
+    speciation::GenusSeed seed = generate(genus);
+    // reproduction and evaluation page the genomes in
+    const size_t reproduction_reads = arena.reads();
+    REQUIRE(reproduction_reads > 20);
+    seed.evaluate(evaluate);
+    REQUIRE(arena.reads() == reproduction_reads + 20);
+
+    // every offspring is a crossover, with its own payload
+    REQUIRE(arena.live_bytes() == 40 * genome_capacity);
+    REQUIRE(arena.file_size() == 40 * genome_capacity);
+
+    auto population_manager = [](std::vector<std::unique_ptr<ArenaIndividual>> &&new_individuals,
+                                 const std::vector<const ArenaIndividual*> &,
+                                 unsigned int) { return std::move(new_individuals); };
+    genus = genus.next_generation(conf, std::move(seed), population_manager);
+    REQUIRE(genus.count_individuals() == 20);
+
+    // the genomes of the old generation are released with the old genus...
+    REQUIRE(arena.live_bytes() == 20 * genome_capacity);
+
+    // ...and their space is reused by the next offspring, the file doesn't grow
+    genus.update(conf);
+    speciation::GenusSeed next_seed = generate(genus);
+    next_seed.evaluate(evaluate);
+    REQUIRE(arena.live_bytes() == 40 * genome_capacity);
+    REQUIRE(arena.file_size() == 40 * genome_capacity);
+}
+
+#endif
@@ -2,9 +2,11 @@
 // Created by matteo on 24/6/20.
 //
 
+#include <cstring>
 #include <speciation/Selection.h>
 #include "catch2/catch.hpp"
 #include "speciation/Genus.h"
+#include "speciation/Numa.h"
 #include "test_individuals.h"
 
 TEST_CASE( "Instantiate a Genus" "[genus]")
@@ -115,4 +117,734 @@ TEST_CASE( "Instantiate a Genus with species" "[genus]")
     } catch (const std::exception &e) {
         FAIL(e.what());
     }
-}
\ No newline at end of file
+}
+TEST_CASE( "Genus with fitness proportional selection" "[genus]")
+{
+    typedef speciation::Species<ChildIndividual,float>::const_iterator CIter;
+    speciation::Genus<ChildIndividual,float> genus;
+    std::vector<std::unique_ptr<ChildIndividual>> initial_population;
+    std::mt19937 gen(0);
+
+    for (int i = 0; i < 10; i++) {
+        initial_population.emplace_back(std::make_unique<ChildIndividual>(i));
+    }
+    int id_counter = static_cast<int>(initial_population.size());
+
+    genus.speciate(initial_population.begin(), initial_population.end());
+
+    const speciation::Conf conf {
+        static_cast<unsigned int>(initial_population.size()),
+        false,
+        2,
+        10,
+        20,
+        1.1,
+        0.9
+    };
+
+    speciation::AliasSelection<float, CIter> alias_selection(gen);
+    speciation::SUSSelection<float, CIter> sus_selection(gen);
+    auto parent_selection = [&sus_selection](auto begin, auto end) {
+        return std::make_pair(sus_selection(begin, end), sus_selection(begin, end));
+    };
+    auto crossover_1 = [&id_counter](const ChildIndividual &parent) -> std::unique_ptr<ChildIndividual> {
+        return std::make_unique<ChildIndividual>(id_counter++);
+    };
+    auto crossover_2 = [&id_counter](const ChildIndividual &parent_a, const ChildIndividual &parent_b) -> std::unique_ptr<ChildIndividual> {
+        return std::make_unique<ChildIndividual>(id_counter++);
+    };
+    auto mutate = [](ChildIndividual &indiv) {};
+    auto population_manager = [](std::vector<std::unique_ptr<ChildIndividual> > &&new_pop,
+                                 const std::vector<const ChildIndividual*> &old_pop,
+                                 unsigned int pop_amount) -> std::vector<std::unique_ptr<ChildIndividual> > {
+        return std::vector<std::unique_ptr<ChildIndividual> >(std::move(new_pop));
+    };
+    auto evaluate = [&gen](ChildIndividual *new_indiv) {
+        static std::uniform_real_distribution<float> dis(0,1);
+        float fit = dis(gen);
+        new_indiv->set_fitness(fit);
+        return fit;
+    };
+
+    genus.ensure_evaluated_population(evaluate);
+
+    try {
+        speciation::GenusSeed generated_individuals = genus.update(conf)
+                .generate_new_individuals(
+                        conf,
+                        alias_selection,
+                        parent_selection,
+                        crossover_1,
+                        crossover_2,
+                        mutate
+                );
+
+        generated_individuals.evaluate(evaluate);
+
+        speciation::Genus genus1 = genus.next_generation(conf,
+                                                         std::move(generated_individuals),
+                                                         population_manager);
+        REQUIRE(genus1.count_individuals() == conf.total_population_size);
+    } catch (const std::exception &e) {
+        FAIL(e.what());
+    }
+}
+
+namespace {
+/// Always compatible, so that the whole population stays in one species
+class SameSpeciesIndividual : public ChildIndividual {
+public:
+    explicit SameSpeciesIndividual(int id) : ChildIndividual(id) {}
+    [[nodiscard]] bool is_compatible(const ChildIndividual &) const override
+    { return true; }
+};
+}
+
+TEST_CASE( "Genus evaluation with cutoff" "[genus]")
+{
+    speciation::Genus<ChildIndividual,float> genus;
+    std::vector<std::unique_ptr<ChildIndividual>> initial_population;
+    for (int i = 0; i < 10; i++) {
+        initial_population.emplace_back(std::make_unique<SameSpeciesIndividual>(i));
+    }
+    int id_counter = static_cast<int>(initial_population.size());
+    genus.speciate(initial_population.begin(), initial_population.end());
+    REQUIRE(genus.size() == 1);
+
+    const speciation::Conf conf {
+        static_cast<unsigned int>(initial_population.size()),
+        false,
+        2,
+        10,
+        20,
+        1.1,
+        0.9
+    };
+
+    auto selection = [](auto begin, auto end) { return begin; };
+    auto parent_selection = [](auto begin, auto end) { return std::make_pair(begin, begin + 1); };
+    auto reproduce = [&id_counter](const ChildIndividual &) -> std::unique_ptr<ChildIndividual> {
+        return std::make_unique<SameSpeciesIndividual>(id_counter++);
+    };
+    auto crossover = [&id_counter](const ChildIndividual &, const ChildIndividual &) -> std::unique_ptr<ChildIndividual> {
+        return std::make_unique<SameSpeciesIndividual>(id_counter++);
+    };
+    auto mutate = [](ChildIndividual &) {};
+
+    // old fitnesses are 1..10
+    genus.ensure_evaluated_population([](ChildIndividual *indiv) {
+        float fitness = static_cast<float>(indiv->get_id() + 1);
+        indiv->set_fitness(fitness);
+        return fitness;
+    });
+
+    speciation::GenusSeed generated_individuals = genus.update(conf)
+            .generate_new_individuals(conf, selection, parent_selection, reproduce, crossover, mutate);
+
+    // every other evaluation is hopeless: it aborts and reports 0
+    std::vector<std::optional<float>> cutoffs;
+    generated_individuals.evaluate_with_cutoff([&cutoffs](ChildIndividual *indiv, const std::optional<float> &cutoff) {
+        cutoffs.emplace_back(cutoff);
+        float fitness = cutoffs.size() % 2 == 1 ? 100.f : 0.f;
+        indiv->set_fitness(fitness);
+        return fitness;
+    });
+
+    // the species keeps 10 individuals: the cutoff starts from the 10th best old fitness, and rises with every
+    // new individual that makes it into the best 10
+    REQUIRE(cutoffs.size() == 10);
+    for (size_t i = 0; i < cutoffs.size(); i++) {
+        REQUIRE(cutoffs[i].has_value());
+        REQUIRE(cutoffs[i].value() == static_cast<float>(1 + (i + 1) / 2));
+    }
+
+    auto population_manager = [](std::vector<std::unique_ptr<ChildIndividual> > &&new_pop,
+                                 const std::vector<const ChildIndividual*> &old_pop,
+                                 unsigned int pop_amount) -> std::vector<std::unique_ptr<ChildIndividual> > {
+        return std::vector<std::unique_ptr<ChildIndividual> >(std::move(new_pop));
+    };
+    speciation::Genus genus1 = genus.next_generation(conf, std::move(generated_individuals), population_manager);
+    REQUIRE(genus1.count_individuals() == conf.total_population_size);
+}
+
+namespace {
+/// Compatible with the individuals with the same id % 3
+class GroupIndividual : public ChildIndividual {
+public:
+    explicit GroupIndividual(int id) : ChildIndividual(id) {}
+    [[nodiscard]] bool is_compatible(const ChildIndividual &other) const override
+    { return get_id() % 3 == other.get_id() % 3; }
+};
+}
+
+TEST_CASE( "Genus parallel population management" "[genus]")
+{
+    speciation::Genus<ChildIndividual,float> genus;
+    std::vector<std::unique_ptr<ChildIndividual>> initial_population;
+    for (int i = 0; i < 30; i++) {
+        initial_population.emplace_back(std::make_unique<GroupIndividual>(i));
+    }
+    genus.speciate(initial_population.begin(), initial_population.end());
+    REQUIRE(genus.size() == 3);
+
+    speciation::Conf conf;
+    conf.total_population_size = static_cast<unsigned int>(initial_population.size());
+    conf.crossover = false;
+
+    auto selection = [](auto begin, auto end) { return begin; };
+    auto parent_selection = [](auto begin, auto end) { return std::make_pair(begin, begin + 1); };
+    auto crossover = [](const ChildIndividual &parent, const ChildIndividual &) -> std::unique_ptr<ChildIndividual> {
+        return std::make_unique<GroupIndividual>(parent.get_id() + 300);
+    };
+    auto mutate = [](ChildIndividual &) {};
+    auto evaluate = [](ChildIndividual *indiv) {
+        float fitness = static_cast<float>(indiv->get_id() % 7 + 1);
+        indiv->set_fitness(fitness);
+        return fitness;
+    };
+    // plus-selection: the best of old and new individuals survive
+    auto population_manager = [](std::vector<std::unique_ptr<ChildIndividual> > &&new_pop,
+                                 const std::vector<const ChildIndividual*> &old_pop,
+                                 unsigned int pop_amount) -> std::vector<std::unique_ptr<ChildIndividual> > {
+        std::vector<std::unique_ptr<ChildIndividual> > candidates = std::move(new_pop);
+        for (const ChildIndividual *old_individual : old_pop) {
+            candidates.emplace_back(std::make_unique<GroupIndividual>(old_individual->get_id()));
+            candidates.back()->set_fitness(old_individual->fitness().value());
+        }
+        std::stable_sort(candidates.begin(), candidates.end(), [](const auto &a, const auto &b) {
+            return a->fitness().value() > b->fitness().value();
+        });
+        candidates.resize(pop_amount);
+        return candidates;
+    };
+
+    genus.ensure_evaluated_population(evaluate);
+    genus.update(conf);
+
+    auto next_generation_ids = [&](speciation::Executor &executor) {
+        int id_counter = 0;
+        auto reproduce = [&id_counter](const ChildIndividual &parent) -> std::unique_ptr<ChildIndividual> {
+            return std::make_unique<GroupIndividual>(parent.get_id() + 3 * (++id_counter) + 99);
+        };
+        speciation::GenusSeed seed = genus.generate_new_individuals(
+                conf, selection, parent_selection, reproduce, crossover, mutate);
+        seed.evaluate(evaluate);
+        speciation::Genus next_genus = genus.next_generation(conf, std::move(seed), population_manager, executor);
+        REQUIRE(next_genus.count_individuals() == conf.total_population_size);
+
+        std::vector<int> ids;
+        for (const ChildIndividual *indiv : next_genus.best_individuals(conf.total_population_size)) {
+            ids.emplace_back(indiv->get_id());
+        }
+        return ids;
+    };
+
+    speciation::SequentialExecutor sequential;
+    speciation::WorkStealingExecutor pool(4);
+    REQUIRE(next_generation_ids(sequential) == next_generation_ids(pool));
+}
+
+namespace {
+/// Compatible with the individuals with the same id / 1000
+class ThousandsIndividual : public ChildIndividual {
+public:
+    explicit ThousandsIndividual(int id) : ChildIndividual(id) {}
+    [[nodiscard]] bool is_compatible(const ChildIndividual &other) const override
+    { return get_id() / 1000 == other.get_id() / 1000; }
+    [[nodiscard]] double distance(const ChildIndividual &other) const
+    { return std::abs(get_id() - other.get_id()); }
+};
+}
+
+TEST_CASE( "Genus parallel orphan adoption" "[genus]")
+{
+    speciation::Genus<ThousandsIndividual,float> genus;
+    std::vector<std::unique_ptr<ThousandsIndividual>> initial_population;
+    for (int group = 0; group < 3; group++) {
+        for (int i = 0; i < 100; i++) {
+            initial_population.emplace_back(std::make_unique<ThousandsIndividual>(group * 1000 + i));
+        }
+    }
+    genus.speciate(initial_population.begin(), initial_population.end());
+    REQUIRE(genus.size() == 3);
+
+    speciation::Conf conf;
+    conf.total_population_size = static_cast<unsigned int>(initial_population.size());
+    conf.crossover = false;
+
+    auto selection = [](auto begin, auto end) { return begin + 1; };
+    auto parent_selection = [](auto begin, auto end) { return std::make_pair(begin, begin + 1); };
+    auto crossover = [](const ThousandsIndividual &parent, const ThousandsIndividual &) -> std::unique_ptr<ThousandsIndividual> {
+        return std::make_unique<ThousandsIndividual>(parent.get_id());
+    };
+    auto mutate = [](ThousandsIndividual &) {};
+    auto evaluate = [](ThousandsIndividual *indiv) {
+        float fitness = static_cast<float>(indiv->get_id() % 7 + 1);
+        indiv->set_fitness(fitness);
+        return fitness;
+    };
+    // the 4 new species keep 60 individuals, the old species make room for them
+    auto population_manager = [](std::vector<std::unique_ptr<ThousandsIndividual> > &&new_pop,
+                                 const std::vector<const ThousandsIndividual*> &old_pop,
+                                 unsigned int pop_amount) -> std::vector<std::unique_ptr<ThousandsIndividual> > {
+        std::vector<std::unique_ptr<ThousandsIndividual> > candidates = std::move(new_pop);
+        for (const ThousandsIndividual *old_individual : old_pop) {
+            candidates.emplace_back(std::make_unique<ThousandsIndividual>(old_individual->get_id()));
+            candidates.back()->set_fitness(old_individual->fitness().value());
+        }
+        candidates.resize(pop_amount - 20);
+        return candidates;
+    };
+
+    genus.ensure_evaluated_population(evaluate);
+    genus.update(conf);
+
+    size_t expected_species = 7;
+    auto next_generation_species = [&](speciation::Executor &executor) {
+        // every 10 children: 2 go in one of 4 new groups, 1 in the next old group, the others stay in their group
+        int k = 0;
+        auto reproduce = [&k](const ThousandsIndividual &parent) -> std::unique_ptr<ThousandsIndividual> {
+            const int group = parent.get_id() / 1000;
+            int new_group = group;
+            if (k % 10 < 2) new_group = 7 + (k / 10) % 4;
+            else if (k % 10 == 2) new_group = (group + 1) % 3;
+            return std::make_unique<ThousandsIndividual>(new_group * 1000 + 500 + k++);
+        };
+        speciation::GenusSeed seed = genus.generate_new_individuals(
+                conf, selection, parent_selection, reproduce, crossover, mutate);
+        seed.evaluate(evaluate);
+        speciation::Genus next_genus = genus.next_generation(conf, std::move(seed), population_manager, executor);
+        REQUIRE(next_genus.count_individuals() == conf.total_population_size);
+
+        REQUIRE(next_genus.size() == expected_species);
+
+        // the order depends on the content and on the order of the species
+        std::vector<int> ids;
+        for (const ThousandsIndividual *indiv : next_genus.best_individuals(conf.total_population_size)) {
+            ids.emplace_back(indiv->get_id());
+        }
+        return ids;
+    };
+
+    speciation::SequentialExecutor sequential_executor;
+    speciation::WorkStealingExecutor pool_2(2);
+    speciation::WorkStealingExecutor pool_5(5);
+    auto sequential = next_generation_species(sequential_executor);
+    REQUIRE(sequential == next_generation_species(pool_2));
+    REQUIRE(sequential == next_generation_species(pool_5));
+
+    // with a cap of 5 species, the orphans of the last 2 new groups join the nearest species (group 8)
+    conf.max_species = 5;
+    genus.update(conf);
+    expected_species = 5;
+    sequential = next_generation_species(sequential_executor);
+    REQUIRE(sequential == next_generation_species(pool_2));
+    REQUIRE(sequential == next_generation_species(pool_5));
+}
+
+namespace {
+/// Compatible with the individuals with an id closer than the compatibility threshold
+class DistanceIndividual : public ChildIndividual {
+public:
+    explicit DistanceIndividual(int id) : ChildIndividual(id, 1) {}
+    [[nodiscard]] bool is_compatible(const ChildIndividual &other) const override
+    { return is_compatible(other, 1.0); }
+    [[nodiscard]] bool is_compatible(const ChildIndividual &other, double threshold) const
+    { return distance(other) < threshold; }
+    [[nodiscard]] double distance(const ChildIndividual &other) const
+    { return std::abs(get_id() - other.get_id()); }
+};
+
+std::vector<std::unique_ptr<DistanceIndividual>> distance_population()
+{
+    std::vector<std::unique_ptr<DistanceIndividual>> population;
+    for (int i = 0; i < 30; i++) {
+        population.emplace_back(std::make_unique<DistanceIndividual>(i));
+    }
+    return population;
+}
+}
+
+TEST_CASE( "Genus adaptive compatibility threshold" "[genus]")
+{
+    speciation::Conf conf;
+    conf.total_population_size = 30;
+    conf.compatibility_threshold = 1;
+    conf.target_species = 3;
+    conf.compatibility_threshold_step = 5;
+    conf.min_compatibility_threshold = 2;
+    conf.max_compatibility_threshold = 20;
+
+    speciation::Genus<DistanceIndividual,float> genus;
+    auto population = distance_population();
+    genus.speciate(population.begin(), population.end(), conf);
+    REQUIRE(genus.get_compatibility_threshold() == 1);
+    REQUIRE(genus.size() == 30);
+
+    // too many species: the threshold grows
+    genus.update(conf);
+    REQUIRE(genus.get_compatibility_threshold() == 6);
+    population = distance_population();
+    genus.speciate(population.begin(), population.end());
+    REQUIRE(genus.size() == 5);
+
+    genus.update(conf);
+    REQUIRE(genus.get_compatibility_threshold() == 11);
+    population = distance_population();
+    genus.speciate(population.begin(), population.end());
+    REQUIRE(genus.size() == 3);
+
+    // on target: the threshold is stable
+    genus.update(conf);
+    REQUIRE(genus.get_compatibility_threshold() == 11);
+
+    // the threshold is used for every insertion: 25 is compatible only with the representative 22
+    genus.insert_individual(std::make_unique<DistanceIndividual>(25));
+    REQUIRE(genus.size() == 3);
+    genus.insert_individual(std::make_unique<DistanceIndividual>(45));
+    REQUIRE(genus.size() == 4);
+
+    // too few species: the threshold decreases, down to the minimum
+    conf.target_species = 10;
+    genus.update(conf);
+    REQUIRE(genus.get_compatibility_threshold() == 6);
+    genus.update(conf);
+    REQUIRE(genus.get_compatibility_threshold() == 2);
+
+    // fixed threshold
+    conf.target_species = 0;
+    genus.update(conf);
+    REQUIRE(genus.get_compatibility_threshold() == 1);
+
+    // unreachable target: the threshold stops at the maximum
+    conf.target_species = 1;
+    conf.max_compatibility_threshold = 13;
+    genus.update(conf);
+    genus.update(conf);
+    REQUIRE(genus.get_compatibility_threshold() == 11);
+    genus.update(conf);
+    REQUIRE(genus.get_compatibility_threshold() == 13);
+    genus.update(conf);
+    REQUIRE(genus.get_compatibility_threshold() == 13);
+}
+
+TEST_CASE( "Genus species cap" "[genus]")
+{
+    speciation::Conf conf;
+    conf.total_population_size = 30;
+    conf.compatibility_threshold = 1;
+    conf.max_species = 4;
+
+    speciation::Genus<DistanceIndividual,float> genus;
+    auto population = distance_population();
+    genus.speciate(population.begin(), population.end(), conf);
+    // representatives 0, 1, 2 and 3: all the others are nearest to 3
+    REQUIRE(genus.size() == 4);
+    REQUIRE(genus.count_individuals() == 30);
+
+    genus.insert_individual(std::make_unique<DistanceIndividual>(100));
+    REQUIRE(genus.size() == 4);
+    REQUIRE(genus.count_individuals() == 31);
+
+    // the individuals without a distance cannot be capped
+    speciation::Genus<ChildIndividual,float> child_genus;
+    std::vector<std::unique_ptr<ChildIndividual>> child_population;
+    for (int i = 0; i < 10; i++) {
+        child_population.emplace_back(std::make_unique<GroupIndividual>(i));
+    }
+    conf.max_species = 2;
+    REQUIRE_THROWS_AS(child_genus.speciate(child_population.begin(), child_population.end(), conf), std::logic_error);
+}
+
+TEST_CASE( "Largest remainder apportionment" "[genus]")
+{
+    using speciation::largest_remainder_apportionment;
+
+    // quotas 3.85, 2.1, 1.05: the only remaining seat goes to the largest remainder
+    REQUIRE(largest_remainder_apportionment({0.55, 0.3, 0.15}, 7) == std::vector<unsigned int>{4, 2, 1});
+    // ties are broken by index
+    REQUIRE(largest_remainder_apportionment({1, 1, 1}, 10) == std::vector<unsigned int>{4, 3, 3});
+    REQUIRE(largest_remainder_apportionment({0, 0}, 5) == std::vector<unsigned int>{3, 2});
+    REQUIRE(largest_remainder_apportionment({0, 2, 0}, 5) == std::vector<unsigned int>{0, 5, 0});
+    REQUIRE(largest_remainder_apportionment({}, 5).empty());
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> weight(0, 100);
+    for (unsigned int total : {1u, 7u, 100u, 1001u}) {
+        std::vector<double> weights(137);
+        for (double &w : weights) w = weight(gen);
+        const double weight_sum = std::accumulate(weights.begin(), weights.end(), 0.);
+
+        std::vector<unsigned int> seats = largest_remainder_apportionment(weights, total);
+        REQUIRE(std::accumulate(seats.begin(), seats.end(), 0u) == total);
+        for (size_t i = 0; i < weights.size(); i++) {
+            const double quota = total * weights[i] / weight_sum;
+            REQUIRE(seats[i] >= std::floor(quota));
+            REQUIRE(seats[i] <= std::ceil(quota));
+        }
+    }
+}
+
+TEST_CASE( "Genus NUMA generation" "[genus]")
+{
+    speciation::Genus<ChildIndividual,float> genus;
+    std::vector<std::unique_ptr<ChildIndividual>> initial_population;
+    for (int i = 0; i < 30; i++) {
+        initial_population.emplace_back(std::make_unique<GroupIndividual>(i));
+    }
+    genus.speciate(initial_population.begin(), initial_population.end());
+
+    speciation::Conf conf;
+    conf.total_population_size = static_cast<unsigned int>(initial_population.size());
+    conf.crossover = false;
+
+    auto selection = [](auto begin, auto end) { return begin; };
+    auto parent_selection = [](auto begin, auto end) { return std::make_pair(begin, begin + 1); };
+    auto crossover = [](const ChildIndividual &parent, const ChildIndividual &) -> std::unique_ptr<ChildIndividual> {
+        return std::make_unique<GroupIndividual>(parent.get_id() + 300);
+    };
+    auto mutate = [](ChildIndividual &) {};
+    auto evaluate = [](ChildIndividual *indiv) {
+        float fitness = static_cast<float>(indiv->get_id() % 3000 % 7 + 1);
+        indiv->set_fitness(fitness);
+        return fitness;
+    };
+    auto population_manager = [](std::vector<std::unique_ptr<ChildIndividual> > &&new_pop,
+                                 const std::vector<const ChildIndividual*> &,
+                                 unsigned int) { return std::move(new_pop); };
+
+    genus.ensure_evaluated_population(evaluate);
+    genus.update(conf);
+
+    // two nodes sharing the CPUs of the host
+    speciation::NumaTopology topology = speciation::NumaTopology::single_node();
+    topology.node_cpus.emplace_back(topology.node_cpus[0]);
+    speciation::NumaExecutor executor(topology, 2);
+
+    std::atomic<int> off_node_evaluations(0);
+    auto next_generation_ids = [&](speciation::NumaExecutor *numa) {
+        auto reproduce = [](const ChildIndividual &parent) -> std::unique_ptr<ChildIndividual> {
+            // the node is encoded in the id (keeping the group), to check where the evaluation runs
+            const int node = std::max(speciation::NumaExecutor::current_node(), 0);
+            return std::make_unique<GroupIndividual>((parent.get_id() % 3000 + 99) % 3000 + 3000 * node);
+        };
+        std::vector<int> ids;
+        if (numa == nullptr) {
+            speciation::GenusSeed seed = genus.generate_new_individuals(
+                    conf, selection, parent_selection, reproduce, crossover, mutate);
+            seed.evaluate(evaluate);
+            speciation::Genus next_genus = genus.next_generation(conf, std::move(seed), population_manager);
+            for (const ChildIndividual *indiv : next_genus.best_individuals(conf.total_population_size))
+                ids.emplace_back(indiv->get_id() % 3000);
+        } else {
+            speciation::GenusSeed seed = genus.generate_new_individuals(
+                    conf, selection, parent_selection, reproduce, crossover, mutate, *numa);
+            seed.evaluate([&](ChildIndividual *indiv) {
+                if (indiv->get_id() / 3000 != speciation::NumaExecutor::current_node())
+                    off_node_evaluations++;
+                return evaluate(indiv);
+            }, *numa);
+            speciation::Genus next_genus = genus.next_generation(conf, std::move(seed), population_manager);
+            REQUIRE(next_genus.count_individuals() == conf.total_population_size);
+            for (const ChildIndividual *indiv : next_genus.best_individuals(conf.total_population_size))
+                ids.emplace_back(indiv->get_id() % 3000);
+        }
+        return ids;
+    };
+
+    REQUIRE(next_generation_ids(nullptr) == next_generation_ids(&executor));
+    REQUIRE(off_node_evaluations == 0);
+}
+
+namespace {
+/// Sequential executor counting its calls, to check that it's used
+class CountingExecutor : public speciation::Executor {
+public:
+    std::atomic<size_t> calls{0};
+    void parallel_for(size_t n, const std::function<void(size_t)> &body) override
+    {
+        calls++;
+        for (size_t i = 0; i < n; i++) body(i);
+    }
+    [[nodiscard]] unsigned int concurrency() const override { return 2; }
+};
+}
+
+TEST_CASE( "Genus with executors" "[genus]")
+{
+    speciation::Conf conf;
+    conf.total_population_size = 60;
+    conf.crossover = false;
+
+    auto selection = [](auto begin, auto end) { return begin; };
+    auto parent_selection = [](auto begin, auto end) { return std::make_pair(begin, begin + 1); };
+    auto reproduce = [](const ChildIndividual &parent) -> std::unique_ptr<ChildIndividual> {
+        // a few orphans
+        return std::make_unique<ThousandsIndividual>(parent.get_id() % 2 == 0 ? parent.get_id() + 5000
+                                                                              : parent.get_id() + 1);
+    };
+    auto crossover = [](const ChildIndividual &parent, const ChildIndividual &) -> std::unique_ptr<ChildIndividual> {
+        return std::make_unique<ThousandsIndividual>(parent.get_id());
+    };
+    auto mutate = [](ChildIndividual &) {};
+    auto evaluate = [](ChildIndividual *indiv) {
+        float fitness = static_cast<float>(indiv->get_id() % 13 + 1);
+        indiv->set_fitness(fitness);
+        return fitness;
+    };
+    auto population_manager = [](std::vector<std::unique_ptr<ChildIndividual> > &&new_pop,
+                                 const std::vector<const ChildIndividual*> &,
+                                 unsigned int) { return std::move(new_pop); };
+
+    auto run_generations = [&](speciation::Executor *executor) {
+        speciation::Genus<ChildIndividual,float> genus;
+        std::vector<std::unique_ptr<ChildIndividual>> population;
+        for (int i = 0; i < 60; i++) {
+            population.emplace_back(std::make_unique<ThousandsIndividual>((i % 4) * 1000 + i));
+        }
+        if (executor) genus.speciate(population.begin(), population.end(), conf, *executor);
+        else genus.speciate(population.begin(), population.end(), conf);
+        REQUIRE(genus.size() == 4);
+
+        std::vector<int> ids;
+        for (int generation = 0; generation < 3; generation++) {
+            if (executor) {
+                genus.ensure_evaluated_population(evaluate, *executor);
+                genus.update(conf, *executor);
+                speciation::GenusSeed seed = genus.generate_new_individuals(
+                        conf, selection, parent_selection, reproduce, crossover, mutate, *executor);
+                seed.evaluate(evaluate, *executor);
+                genus = genus.next_generation(conf, std::move(seed), population_manager, *executor);
+            } else {
+                genus.ensure_evaluated_population(evaluate);
+                genus.update(conf);
+                speciation::GenusSeed seed = genus.generate_new_individuals(
+                        conf, selection, parent_selection, reproduce, crossover, mutate);
+                seed.evaluate(evaluate);
+                genus = genus.next_generation(conf, std::move(seed), population_manager);
+            }
+            REQUIRE(genus.count_individuals() == conf.total_population_size);
+        }
+        for (const ChildIndividual *indiv : genus.best_individuals(conf.total_population_size))
+            ids.emplace_back(indiv->get_id());
+        std::sort(ids.begin(), ids.end());
+        ids.emplace_back(-static_cast<int>(genus.size()));
+        return ids;
+    };
+
+    const std::vector<int> sequential = run_generations(nullptr);
+    // the orphans founded new species
+    REQUIRE(std::any_of(sequential.begin(), sequential.end(), [](int id) { return id >= 5000; }));
+
+    speciation::WorkStealingExecutor pool(4);
+    REQUIRE(run_generations(&pool) == sequential);
+
+    CountingExecutor counting;
+    REQUIRE(run_generations(&counting) == sequential);
+    REQUIRE(counting.calls > 0);
+}
+
+TEST_CASE( "Genus deterministic parallel run" "[genus]")
+{
+    speciation::Conf conf;
+    conf.total_population_size = 200;
+    conf.crossover = true;
+
+    using Iter = speciation::Species<ChildIndividual,float>::const_iterator;
+    using speciation::Philox4x32;
+    auto selection = [](Iter begin, Iter end, Philox4x32 &random) {
+        return speciation::tournament_selection<float>(begin, end, random, 2);
+    };
+    auto parent_selection = [](Iter begin, Iter end, Philox4x32 &random) {
+        return std::make_pair(speciation::tournament_selection<float>(begin, end, random, 2),
+                              speciation::tournament_selection<float>(begin, end, random, 2));
+    };
+    auto reproduce = [](const ChildIndividual &parent, Philox4x32 &random) -> std::unique_ptr<ChildIndividual> {
+        return std::make_unique<ThousandsIndividual>(
+                parent.get_id() / 1000 * 1000 + static_cast<int>(speciation::bounded_rand(random, 1000)));
+    };
+    auto crossover = [](const ChildIndividual &parent1, const ChildIndividual &parent2, Philox4x32 &random)
+            -> std::unique_ptr<ChildIndividual> {
+        const int offset = (parent1.get_id() % 1000 + parent2.get_id() % 1000) / 2;
+        return std::make_unique<ThousandsIndividual>(
+                parent1.get_id() / 1000 * 1000 + (offset + static_cast<int>(speciation::bounded_rand(random, 50))) % 1000);
+    };
+    auto mutate = [](ChildIndividual &child, Philox4x32 &random) {
+        // a few orphans
+        if (speciation::bounded_rand(random, 50) == 0) child.set_id(child.get_id() + 1000);
+    };
+    auto evaluate = [](ChildIndividual *indiv) {
+        float fitness = static_cast<float>(indiv->get_id() % 997) / 7.f;
+        indiv->set_fitness(fitness);
+        return fitness;
+    };
+    auto population_manager = [](std::vector<std::unique_ptr<ChildIndividual> > &&new_pop,
+                                 const std::vector<const ChildIndividual*> &,
+                                 unsigned int,
+                                 Philox4x32 &random) {
+        std::shuffle(new_pop.begin(), new_pop.end(), random);
+        return std::move(new_pop);
+    };
+
+    auto hash_genus = [](const speciation::Genus<ChildIndividual,float> &genus) {
+        // FNV-1a of the species, individuals and (adjusted) fitnesses, bit for bit
+        uint64_t hash = 14695981039346656037ull;
+        auto add = [&hash](uint64_t value) {
+            for (int byte = 0; byte < 8; byte++) {
+                hash ^= (value >> (8 * byte)) & 0xFF;
+                hash *= 1099511628211ull;
+            }
+        };
+        auto float_bits = [](float value) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        };
+        add(genus.generation());
+        for (const speciation::Species<ChildIndividual,float> &species : genus.get_species_collection()) {
+            add(species.id());
+            for (const auto &indiv : species) {
+                add(static_cast<uint64_t>(indiv.individual->get_id()));
+                add(float_bits(indiv.individual->fitness().value_or(-1.f)));
+                add(float_bits(indiv.adjusted_fitness.value_or(-1.f)));
+            }
+        }
+        return hash;
+    };
+
+    auto run = [&](speciation::Executor &executor) {
+        const speciation::RandomStreams streams(42);
+        speciation::Genus<ChildIndividual,float> genus;
+        std::vector<std::unique_ptr<ChildIndividual>> population;
+        for (int i = 0; i < 200; i++) {
+            population.emplace_back(std::make_unique<ThousandsIndividual>((i % 4) * 1000 + i));
+        }
+        genus.speciate(population.begin(), population.end(), conf, executor);
+
+        std::vector<uint64_t> hashes;
+        for (int generation = 0; generation < 8; generation++) {
+            genus.ensure_evaluated_population(evaluate, executor);
+            genus.update(conf, executor);
+            hashes.emplace_back(hash_genus(genus));
+            speciation::GenusSeed seed = genus.generate_new_individuals(
+                    conf, streams, selection, parent_selection, reproduce, crossover, mutate, executor);
+            seed.evaluate(evaluate, executor);
+            genus = genus.next_generation(conf, std::move(seed), population_manager, streams, executor);
+            REQUIRE(genus.count_individuals() == conf.total_population_size);
+            REQUIRE(genus.generation() == static_cast<unsigned int>(generation + 1));
+        }
+        hashes.emplace_back(hash_genus(genus));
+        REQUIRE(genus.size() > 4);
+        return hashes;
+    };
+
+    speciation::SequentialExecutor sequential;
+    const std::vector<uint64_t> reference = run(sequential);
+
+    for (unsigned int threads : {1u, 8u, 128u}) {
+        speciation::WorkStealingExecutor pool(threads);
+        REQUIRE(run(pool) == reference);
+    }
+    speciation::NumaExecutor numa(speciation::NumaTopology{{{0}, {0}}}, 2);
+    REQUIRE(run(numa) == reference);
+}
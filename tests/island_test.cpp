@@ -0,0 +1,217 @@
+#include <speciation/IslandModel.h>
+#include <speciation/Selection.h>
+#include "catch2/catch.hpp"
+#include "test_individuals.h"
+
+namespace {
+
+/// Individual where everybody is compatible with everybody: one species per island, plus migrants
+class IslandIndividual : public speciation::IndividualPrototype<float, IslandIndividual> {
+    int _island;
+    std::optional<float> _fitness;
+public:
+    IslandIndividual(int island, std::optional<float> fitness = std::nullopt)
+        : _island(island), _fitness(fitness)
+    {}
+
+    [[nodiscard]] std::optional<float> fitness() const override
+    { return _fitness; }
+
+    void set_fitness(float fit)
+    { _fitness = fit; }
+
+    [[nodiscard]] int island() const
+    { return _island; }
+
+    [[nodiscard]] bool is_compatible(const IslandIndividual &) const override
+    { return true; }
+
+    [[nodiscard]] IslandIndividual clone() const override
+    { return IslandIndividual(*this); }
+};
+
+}
+
+TEST_CASE("Bounded queue" "[island]")
+{
+    speciation::BoundedQueue<std::unique_ptr<int> > queue(3);
+    REQUIRE(queue.capacity() == 4);
+
+    std::unique_ptr<int> value;
+    REQUIRE_FALSE(queue.try_pop(value));
+
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(queue.try_push(std::make_unique<int>(i)));
+    }
+    std::unique_ptr<int> rejected = std::make_unique<int>(42);
+    REQUIRE_FALSE(queue.try_push(std::move(rejected)));
+    // not moved when the queue is full
+    REQUIRE(rejected != nullptr);
+
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(queue.try_pop(value));
+        REQUIRE(*value == i);
+    }
+    REQUIRE_FALSE(queue.try_pop(value));
+}
+
+TEST_CASE("Bounded queue with concurrent producers and consumers" "[island]")
+{
+    speciation::BoundedQueue<int> queue(16);
+    constexpr int per_producer = 10000;
+    std::atomic<long> consumed_sum(0);
+    std::atomic<int> consumed_count(0);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < 2; p++) {
+        threads.emplace_back([&queue]() {
+            for (int i = 1; i <= per_producer; i++) {
+                int value = i;
+                while (!queue.try_push(std::move(value))) std::this_thread::yield();
+            }
+        });
+    }
+    for (int c = 0; c < 2; c++) {
+        threads.emplace_back([&]() {
+            int value;
+            while (consumed_count < 2 * per_producer) {
+                if (queue.try_pop(value)) {
+                    consumed_sum += value;
+                    consumed_count++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread &t : threads) t.join();
+
+    REQUIRE(consumed_count == 2 * per_producer);
+    REQUIRE(consumed_sum == 2L * per_producer * (per_producer + 1) / 2);
+}
+
+TEST_CASE("Island model with migration" "[island]")
+{
+    constexpr size_t n_islands = 4;
+    constexpr unsigned int population_size = 10;
+
+    const speciation::Conf conf {
+        population_size,
+        false,
+        2,
+        10,
+        20,
+        1.1,
+        0.9
+    };
+
+    auto evaluate_all = [](speciation::Genus<IslandIndividual, float> &genus, std::mt19937 &gen) {
+        genus.ensure_evaluated_population([&gen](IslandIndividual *indiv) {
+            std::uniform_real_distribution<float> dis(0, 1);
+            float fit = dis(gen);
+            indiv->set_fitness(fit);
+            return fit;
+        });
+    };
+
+    std::vector<std::mt19937> generators;
+    std::vector<speciation::Genus<IslandIndividual, float> > islands;
+    for (size_t island = 0; island < n_islands; island++) {
+        generators.emplace_back(island);
+        std::vector<std::unique_ptr<IslandIndividual> > population;
+        for (unsigned int i = 0; i < population_size; i++) {
+            population.emplace_back(std::make_unique<IslandIndividual>(island));
+        }
+        islands.emplace_back();
+        islands.back().speciate(population.begin(), population.end());
+        evaluate_all(islands.back(), generators.back());
+    }
+
+    for (auto topology : {speciation::IslandConf::Topology::Ring, speciation::IslandConf::Topology::Random}) {
+        for (bool synchronous : {false, true}) {
+            std::vector<speciation::Genus<IslandIndividual, float> > copy_islands;
+            for (size_t island = 0; island < n_islands; island++) {
+                std::vector<std::unique_ptr<IslandIndividual> > population;
+                for (unsigned int i = 0; i < population_size; i++) {
+                    population.emplace_back(std::make_unique<IslandIndividual>(island));
+                }
+                copy_islands.emplace_back();
+                copy_islands.back().speciate(population.begin(), population.end());
+                evaluate_all(copy_islands.back(), generators[island]);
+            }
+
+            speciation::IslandConf island_conf;
+            island_conf.migration_interval = 2;
+            island_conf.migrants = 2;
+            island_conf.topology = topology;
+            island_conf.synchronous = synchronous;
+            speciation::IslandModel<IslandIndividual, float> model(std::move(copy_islands), island_conf);
+            REQUIRE(model.size() == n_islands);
+
+            std::vector<char> received_migrant(n_islands, false);
+
+            model.run(6, [&](speciation::Genus<IslandIndividual, float> &genus, size_t island, unsigned int) {
+                std::mt19937 &gen = generators[island];
+                for (const IslandIndividual *indiv : genus.best_individuals(genus.count_individuals())) {
+                    if (indiv->island() != static_cast<int>(island))
+                        received_migrant[island] = true;
+                }
+
+                auto selection = [&gen](auto begin, auto end) {
+                    return speciation::tournament_selection<float>(begin, end, gen, 2);
+                };
+                auto parent_selection = [](auto begin, auto) {
+                    return std::make_pair(begin, begin);
+                };
+                auto reproduce = [island](const IslandIndividual &) {
+                    return std::make_unique<IslandIndividual>(island);
+                };
+                auto crossover = [island](const IslandIndividual &, const IslandIndividual &) {
+                    return std::make_unique<IslandIndividual>(island);
+                };
+                auto mutate = [](IslandIndividual &) {};
+                auto population_manager = [](std::vector<std::unique_ptr<IslandIndividual> > &&new_pop,
+                                             const std::vector<const IslandIndividual*> &,
+                                             unsigned int) {
+                    return std::vector<std::unique_ptr<IslandIndividual> >(std::move(new_pop));
+                };
+                auto evaluate = [&gen](IslandIndividual *indiv) {
+                    std::uniform_real_distribution<float> dis(0, 1);
+                    float fit = dis(gen);
+                    indiv->set_fitness(fit);
+                    return fit;
+                };
+
+                speciation::GenusSeed<IslandIndividual, float> seed = genus.update(conf)
+                        .generate_new_individuals(conf, selection, parent_selection, reproduce, crossover, mutate);
+                seed.evaluate(evaluate);
+                genus = genus.next_generation(conf, std::move(seed), population_manager);
+            });
+
+            // 3 migration rounds, 2 migrants each (the last round is still in the queues)
+            REQUIRE(model.sent_migrants() == 3 * 2 * n_islands);
+            REQUIRE(model.dropped_migrants() == 0);
+            for (size_t island = 0; island < n_islands; island++) {
+                REQUIRE(model.island(island).count_individuals() == population_size);
+                if (synchronous)
+                    REQUIRE(received_migrant[island]);
+            }
+        }
+    }
+}
+
+TEST_CASE("Island model propagates exceptions" "[island]")
+{
+    std::vector<speciation::Genus<IslandIndividual, float> > islands(3);
+    speciation::IslandConf island_conf;
+    island_conf.synchronous = true;
+    island_conf.migration_interval = 1;
+    speciation::IslandModel<IslandIndividual, float> model(std::move(islands), island_conf);
+
+    REQUIRE_THROWS_AS(
+            model.run(10, [](speciation::Genus<IslandIndividual, float> &, size_t island, unsigned int generation) {
+                if (island == 1 && generation == 3)
+                    throw std::runtime_error("island failure");
+            }),
+            std::runtime_error);
+}
@@ -0,0 +1,168 @@
+#include <speciation/MultiObjective.h>
+#include <speciation/Genus.h>
+#include <speciation/Selection.h>
+#include "catch2/catch.hpp"
+#include "test_individuals.h"
+
+#include <random>
+
+using speciation::Objectives;
+
+namespace {
+
+/// Fronts with the NSGA-II fast non-dominated sort, O(MN^2)
+std::vector<unsigned int> naive_non_dominated_sort(const std::vector<Objectives> &points)
+{
+    std::vector<unsigned int> ranks(points.size(), 0);
+    std::vector<size_t> domination_count(points.size(), 0);
+    std::vector<std::vector<size_t> > dominated(points.size());
+    std::vector<size_t> front;
+    for (size_t p = 0; p < points.size(); p++) {
+        for (size_t q = 0; q < points.size(); q++) {
+            if (speciation::dominates(points[p], points[q])) dominated[p].emplace_back(q);
+            else if (speciation::dominates(points[q], points[p])) domination_count[p]++;
+        }
+        if (domination_count[p] == 0) front.emplace_back(p);
+    }
+    for (unsigned int rank = 0; !front.empty(); rank++) {
+        std::vector<size_t> next_front;
+        for (size_t p : front) {
+            ranks[p] = rank;
+            for (size_t q : dominated[p]) {
+                if (--domination_count[q] == 0) next_front.emplace_back(q);
+            }
+        }
+        front = std::move(next_front);
+    }
+    return ranks;
+}
+
+/// Individual with objectives derived from its id
+class ObjectivesIndividual : public ChildIndividual {
+public:
+    explicit ObjectivesIndividual(int id) : ChildIndividual(id) {}
+    [[nodiscard]] bool is_compatible(const ChildIndividual &other) const override
+    { return get_id() % 2 == other.get_id() % 2; }
+    [[nodiscard]] ChildIndividual clone() const override { return ObjectivesIndividual(get_id()); }
+};
+
+Objectives objectives_of(const ChildIndividual &individual)
+{
+    // a trade-off between the two objectives, and a third one
+    const int id = individual.get_id();
+    return {static_cast<double>(id % 10), static_cast<double>(9 - id % 10) - (id / 10) % 3, static_cast<double>(id % 7)};
+}
+
+}
+
+TEST_CASE("Non-dominated sort" "[multi_objective]")
+{
+    // maximizing both
+    const std::vector<Objectives> points = {{1., 5.}, {2., 4.}, {1., 4.}, {0., 0.}, {2., 4.}, {3., 1.}, {1., 1.}};
+    REQUIRE(speciation::non_dominated_sort(points) == std::vector<unsigned int>{0, 0, 1, 3, 0, 0, 2});
+    REQUIRE(speciation::non_dominated_sort({}).empty());
+
+    std::mt19937 gen(0);
+    for (size_t n_objectives : {2, 3, 5}) {
+        std::uniform_int_distribution<int> value(0, 20);
+        std::vector<Objectives> random_points(500, Objectives(n_objectives));
+        for (Objectives &point : random_points) {
+            for (double &objective : point) objective = value(gen);
+        }
+        REQUIRE(speciation::non_dominated_sort(random_points) == naive_non_dominated_sort(random_points));
+    }
+}
+
+TEST_CASE("Crowding distance and Pareto fitness" "[multi_objective]")
+{
+    const std::vector<Objectives> points = {{0., 4.}, {1., 3.}, {3., 1.}, {4., 0.}, {0., 0.}};
+    const std::vector<unsigned int> ranks = speciation::non_dominated_sort(points);
+    REQUIRE(ranks == std::vector<unsigned int>{0, 0, 0, 0, 1});
+
+    const std::vector<double> crowding = speciation::crowding_distance(points, ranks);
+    REQUIRE(std::isinf(crowding[0]));
+    REQUIRE(std::isinf(crowding[3]));
+    REQUIRE(crowding[1] == Approx(3. / 4. + 3. / 4.));
+    REQUIRE(crowding[2] == Approx(crowding[1]));
+    REQUIRE(std::isinf(crowding[4]));
+
+    // better front first, then less crowded
+    const float extreme = speciation::pareto_fitness<float>(0, crowding[0], 2);
+    const float middle = speciation::pareto_fitness<float>(0, crowding[1], 2);
+    const float dominated = speciation::pareto_fitness<float>(1, crowding[4], 2);
+    REQUIRE(extreme > middle);
+    REQUIRE(middle > dominated);
+    REQUIRE(dominated > 0.f);
+}
+
+TEST_CASE("Pareto survivors" "[multi_objective]")
+{
+    std::vector<std::unique_ptr<ChildIndividual> > new_individuals;
+    for (int id : {0, 13, 25}) new_individuals.emplace_back(std::make_unique<ObjectivesIndividual>(id));
+    const ObjectivesIndividual old_a(9), old_b(20);
+    const std::vector<const ChildIndividual *> old_individuals = {&old_a, &old_b};
+    // fronts: 9 and 20 are non-dominated, then 0 and 25, then 13
+    std::vector<std::unique_ptr<ChildIndividual> > survivors = speciation::pareto_survivors<ChildIndividual>(
+            std::move(new_individuals), old_individuals, 3, objectives_of);
+
+    std::vector<int> ids;
+    for (const std::unique_ptr<ChildIndividual> &survivor : survivors) ids.emplace_back(survivor->get_id());
+    REQUIRE(ids.size() == 3);
+    REQUIRE(std::count(ids.begin(), ids.end(), 9) == 1);
+    REQUIRE(std::count(ids.begin(), ids.end(), 20) == 1);
+    REQUIRE(std::count(ids.begin(), ids.end(), 13) == 0);
+}
+
+TEST_CASE("Multi-objective Genus" "[multi_objective]")
+{
+    speciation::Conf conf;
+    conf.total_population_size = 30;
+    conf.crossover = false;
+
+    auto set_fitness = [](ChildIndividual &individual, float fitness) { individual.set_fitness(fitness); };
+    std::vector<std::unique_ptr<ChildIndividual> > population;
+    for (int i = 0; i < 30; i++) {
+        population.emplace_back(std::make_unique<ObjectivesIndividual>(i));
+    }
+    speciation::Genus<ChildIndividual, float> genus;
+    genus.speciate(population.begin(), population.end(), conf);
+    REQUIRE(genus.size() == 2);
+
+    std::mt19937 gen(0);
+    for (int generation = 0; generation < 3; generation++) {
+        genus.assign_pareto_fitness(objectives_of, set_fitness);
+        genus.update(conf);
+        speciation::GenusSeed seed = genus.generate_new_individuals(
+                conf,
+                [&gen](auto begin, auto end) { return speciation::tournament_selection<float>(begin, end, gen, 2); },
+                [](auto begin, auto) { return std::make_pair(begin, begin + 1); },
+                [](const ChildIndividual &parent) -> std::unique_ptr<ChildIndividual> {
+                    return std::make_unique<ObjectivesIndividual>(parent.get_id() + 2);
+                },
+                [](const ChildIndividual &parent, const ChildIndividual &) -> std::unique_ptr<ChildIndividual> {
+                    return std::make_unique<ObjectivesIndividual>(parent.get_id());
+                },
+                [](ChildIndividual &) {});
+        // temporary fitness, the new individuals are ranked with the whole population in the next generation
+        seed.evaluate([](ChildIndividual *individual) {
+            individual->set_fitness(1.f);
+            return 1.f;
+        });
+        genus = genus.next_generation(conf, std::move(seed),
+                [](std::vector<std::unique_ptr<ChildIndividual> > &&new_individuals,
+                   const std::vector<const ChildIndividual *> &old_individuals,
+                   unsigned int target_population) {
+                    return speciation::pareto_survivors<ChildIndividual>(
+                            std::move(new_individuals), old_individuals, target_population, objectives_of);
+                });
+        REQUIRE(genus.count_individuals() == conf.total_population_size);
+    }
+
+    // the best individuals are on the first front
+    genus.assign_pareto_fitness(objectives_of, set_fitness);
+    std::vector<const ChildIndividual *> ranked = genus.best_individuals(conf.total_population_size);
+    const Objectives best = objectives_of(*ranked.front());
+    for (const ChildIndividual *individual : ranked)
+        REQUIRE_FALSE(speciation::dominates(objectives_of(*individual), best));
+    REQUIRE(ranked.back()->fitness().value() >= 1.f);
+}
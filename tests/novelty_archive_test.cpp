@@ -0,0 +1,130 @@
+#include <speciation/NoveltyArchive.h>
+#include <speciation/Genus.h>
+#include "catch2/catch.hpp"
+#include "test_individuals.h"
+
+#include <random>
+
+using speciation::NoveltyArchive;
+
+namespace {
+class NoveltyIndividual : public ChildIndividual {
+public:
+    explicit NoveltyIndividual(int id) : ChildIndividual(id) {}
+    [[nodiscard]] bool is_compatible(const ChildIndividual &) const override { return true; }
+};
+}
+
+TEST_CASE("Novelty archive k nearest neighbours" "[novelty]")
+{
+    NoveltyArchive archive(3, 5);
+    REQUIRE(archive.empty());
+    REQUIRE(archive.novelty({1., 2., 3.}) == 0.);
+    REQUIRE_THROWS_AS(archive.novelty({1., 2.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(NoveltyArchive(0), std::invalid_argument);
+
+    // less than k behaviors: mean distance to all of them
+    archive.insert({0., 0., 0.});
+    archive.insert({3., 4., 0.});
+    REQUIRE(archive.novelty({0., 0., 0.}) == Approx(2.5));
+
+    // against a naive search, over several blocks
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> uniform(-10., 10.);
+    std::vector<std::vector<double> > behaviors(2000);
+    for (std::vector<double> &behavior : behaviors) {
+        behavior = {uniform(gen), uniform(gen), uniform(gen)};
+        archive.insert(behavior);
+    }
+    behaviors.push_back({0., 0., 0.});
+    behaviors.push_back({3., 4., 0.});
+    REQUIRE(archive.size() == behaviors.size());
+
+    for (int query_i = 0; query_i < 20; query_i++) {
+        const std::vector<double> query = {uniform(gen), uniform(gen), uniform(gen)};
+        std::vector<double> distances;
+        for (const std::vector<double> &behavior : behaviors) {
+            distances.push_back(std::sqrt(std::pow(behavior[0] - query[0], 2)
+                                          + std::pow(behavior[1] - query[1], 2)
+                                          + std::pow(behavior[2] - query[2], 2)));
+        }
+        std::sort(distances.begin(), distances.end());
+        const double expected = (distances[0] + distances[1] + distances[2] + distances[3] + distances[4]) / 5.;
+        REQUIRE(archive.novelty(query) == Approx(expected));
+    }
+}
+
+TEST_CASE("Novelty archive commits novel proposals" "[novelty]")
+{
+    NoveltyArchive archive(1, 2, 6.);
+
+    // the first k are always archived
+    archive.propose({0.});
+    archive.propose({0.5});
+    REQUIRE(archive.size() == 0);
+    REQUIRE(archive.commit() == 2);
+
+    // proposals are scored in sorted order, against the ones archived before them
+    archive.propose({10.});
+    archive.propose({1.});
+    archive.propose({10.5});
+    REQUIRE(archive.commit() == 1);
+    REQUIRE(archive.size() == 3);
+    REQUIRE(archive.behavior(2) == std::vector<double>{10.});
+
+    REQUIRE(archive.commit() == 0);
+}
+
+TEST_CASE("Novelty search with a Genus" "[novelty]")
+{
+    speciation::Conf conf;
+    conf.total_population_size = 40;
+    conf.crossover = false;
+
+    NoveltyArchive archive(2, 3, 0.5);
+    auto evaluate = archive.wrap<ChildIndividual, float>(
+            [](ChildIndividual *individual) {
+                const int id = individual->get_id();
+                return std::vector<double>{static_cast<double>(id % 100), static_cast<double>(id / 100 % 100)};
+            },
+            [](ChildIndividual &individual, double novelty) {
+                const float fitness = static_cast<float>(novelty);
+                individual.set_fitness(fitness);
+                return fitness;
+            });
+
+    std::vector<std::unique_ptr<ChildIndividual> > population;
+    for (int i = 0; i < 40; i++) {
+        population.emplace_back(std::make_unique<NoveltyIndividual>(i));
+    }
+    speciation::Genus<ChildIndividual, float> genus;
+    genus.speciate(population.begin(), population.end(), conf);
+    genus.ensure_evaluated_population(evaluate);
+    // all the individuals are scored against the empty archive
+    REQUIRE(genus.best_individuals(1)[0]->fitness() == 0.f);
+    REQUIRE(archive.commit() > 0);
+
+    int next_id = 40;
+    speciation::WorkStealingExecutor executor(4);
+    for (int generation = 0; generation < 3; generation++) {
+        const size_t archive_size = archive.size();
+        genus.update(conf);
+        speciation::GenusSeed seed = generate_from_first_individual(
+                genus, conf,
+                [&next_id](const ChildIndividual &) -> std::unique_ptr<ChildIndividual> {
+                    next_id += 37;
+                    return std::make_unique<NoveltyIndividual>(next_id);
+                },
+                [](ChildIndividual &) {});
+        seed.evaluate(evaluate, executor);
+        for (ChildIndividual *individual : seed) {
+            REQUIRE(individual->fitness().value() > 0.f);
+        }
+        archive.commit();
+        REQUIRE(archive.size() > archive_size);
+        genus = genus.next_generation(conf, std::move(seed),
+                [](std::vector<std::unique_ptr<ChildIndividual> > &&new_individuals,
+                   const std::vector<const ChildIndividual*> &,
+                   unsigned int) { return std::move(new_individuals); });
+    }
+}
@@ -0,0 +1,122 @@
+#include <speciation/Numa.h>
+#include "catch2/catch.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace speciation;
+
+TEST_CASE("NUMA topology" "[numa]")
+{
+    REQUIRE(NumaTopology::parse_cpulist("0-3,8,10-11\n") == std::vector<unsigned int>{0, 1, 2, 3, 8, 10, 11});
+    REQUIRE(NumaTopology::parse_cpulist("").empty());
+    REQUIRE(NumaTopology::parse_cpulist("garbage").empty());
+
+    // fake sysfs: two nodes with CPUs and a memory-only node
+    char directory[] = "/tmp/speciation_numa_XXXXXX";
+    REQUIRE(mkdtemp(directory) != nullptr);
+    const std::string root = directory;
+    std::ofstream(root + "/online") << "0-2\n";
+    const char *cpulists[] = {"0-3\n", "4-7\n", "\n"};
+    for (int node = 0; node < 3; node++) {
+        const std::string node_directory = root + "/node" + std::to_string(node);
+        mkdir(node_directory.c_str(), 0755);
+        std::ofstream(node_directory + "/cpulist") << cpulists[node];
+    }
+
+    NumaTopology topology = NumaTopology::detect(root);
+    REQUIRE(topology.n_nodes() == 2);
+    REQUIRE(topology.node_cpus[1] == std::vector<unsigned int>{4, 5, 6, 7});
+
+    for (int node = 0; node < 3; node++) {
+        const std::string node_directory = root + "/node" + std::to_string(node);
+        unlink((node_directory + "/cpulist").c_str());
+        rmdir(node_directory.c_str());
+    }
+    unlink((root + "/online").c_str());
+    rmdir(root.c_str());
+
+    // unreadable topology: single node
+    REQUIRE(NumaTopology::detect(root).n_nodes() == 1);
+    REQUIRE(NumaTopology::detect().n_nodes() >= 1);
+}
+
+TEST_CASE("NUMA species placement" "[numa]")
+{
+    NumaPlacement placement(2, 0.25);
+    std::vector<unsigned int> nodes = placement.place({1, 2, 3, 4}, {10, 10, 10, 10});
+    REQUIRE(nodes == std::vector<unsigned int>{0, 1, 0, 1});
+
+    // small shifts: the species stay on their node
+    REQUIRE(placement.place({1, 2, 3, 4}, {12, 9, 10, 11}) == nodes);
+    REQUIRE(placement.rebalances() == 0);
+
+    // new species go to the least loaded node, extinct ones are forgotten
+    REQUIRE(placement.place({1, 2, 4, 5}, {12, 9, 11, 3}) == std::vector<unsigned int>{0, 1, 1, 0});
+
+    // large shift: rebalanced
+    nodes = placement.place({1, 2, 4, 5}, {40, 1, 1, 40});
+    REQUIRE(placement.rebalances() == 1);
+    REQUIRE(nodes[0] != nodes[3]);
+
+    // a single huge species cannot be balanced any better: nothing moves
+    nodes = placement.place({1, 2, 4, 5}, {100, 1, 1, 1});
+    const size_t rebalances = placement.rebalances();
+    REQUIRE(placement.place({1, 2, 4, 5}, {100, 1, 1, 1}) == nodes);
+    REQUIRE(placement.rebalances() == rebalances);
+
+    NumaPlacement single(1);
+    REQUIRE(single.place({1, 2}, {100, 1}) == std::vector<unsigned int>{0, 0});
+}
+
+TEST_CASE("NUMA executor" "[numa]")
+{
+    // two nodes sharing the CPUs of the host
+    NumaTopology topology = NumaTopology::single_node();
+    topology.node_cpus.emplace_back(topology.node_cpus[0]);
+    NumaExecutor executor(topology, 2);
+    REQUIRE(executor.n_nodes() == 2);
+    REQUIRE(NumaExecutor::current_node() == -1);
+
+    std::vector<unsigned int> task_nodes(100);
+    for (size_t i = 0; i < task_nodes.size(); i++) task_nodes[i] = i % 3 == 0 ? 1 : 0;
+    std::vector<int> ran_on(task_nodes.size(), -1);
+    std::vector<std::atomic<int> > runs(task_nodes.size());
+    std::mutex threads_mutex;
+    std::set<std::thread::id> threads;
+    executor.parallel_for_nodes(task_nodes, [&](size_t i) {
+        ran_on[i] = NumaExecutor::current_node();
+        runs[i]++;
+        std::lock_guard<std::mutex> lock(threads_mutex);
+        threads.insert(std::this_thread::get_id());
+    });
+    for (size_t i = 0; i < task_nodes.size(); i++) {
+        REQUIRE(runs[i] == 1);
+        REQUIRE(ran_on[i] == static_cast<int>(task_nodes[i]));
+    }
+
+    // the pools are persistent, and the nested calls stay on the node of the calling thread
+    std::atomic<int> off_node(0);
+    executor.parallel_for_nodes(task_nodes, [&](size_t i) {
+        executor.parallel_for(10, [&](size_t) {
+            if (NumaExecutor::current_node() != static_cast<int>(task_nodes[i])) off_node++;
+            std::lock_guard<std::mutex> lock(threads_mutex);
+            threads.insert(std::this_thread::get_id());
+        });
+    });
+    REQUIRE(off_node == 0);
+    REQUIRE(threads.size() <= executor.concurrency());
+    REQUIRE(executor.concurrency() == 4);
+
+    REQUIRE_THROWS_AS(executor.parallel_for_nodes(task_nodes, [](size_t i) {
+        if (i == 42) throw std::runtime_error("task failed");
+    }), std::runtime_error);
+}
@@ -0,0 +1,168 @@
+#include <speciation/ProcessPool.h>
+#include "catch2/catch.hpp"
+#include "test_individuals.h"
+
+#ifdef SPECIATION_HAS_PROCESS_POOL
+
+#include <atomic>
+#include <cstring>
+#include <signal.h>
+#include <sys/mman.h>
+
+namespace {
+
+size_t serialize_id(const ChildIndividual &indiv, char *buffer, size_t capacity)
+{
+    const int id = indiv.get_id();
+    if (capacity >= sizeof(id))
+        std::memcpy(buffer, &id, sizeof(id));
+    return sizeof(id);
+}
+
+int deserialize_id(const char *genome, size_t size)
+{
+    int id;
+    assert(size == sizeof(id));
+    std::memcpy(&id, genome, sizeof(id));
+    return id;
+}
+
+void set_fitness(ChildIndividual &indiv, float fitness)
+{
+    indiv.set_fitness(fitness);
+}
+
+/// Counter shared between the test and the worker processes
+struct SharedCounter {
+    std::atomic<int> *value;
+    SharedCounter()
+    {
+        void *memory = mmap(nullptr, sizeof(std::atomic<int>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        value = new (memory) std::atomic<int>(0);
+    }
+    ~SharedCounter()
+    {
+        munmap(value, sizeof(std::atomic<int>));
+    }
+};
+
+}
+
+TEST_CASE("Process pool evaluates in worker processes" "[process_pool]")
+{
+    speciation::ProcessPoolConf conf;
+    conf.workers = 3;
+    conf.shared_memory_size = 3 * 64;
+    conf.max_batch_size = 8;
+
+    const pid_t main_pid = getpid();
+    speciation::ProcessPool<ChildIndividual, float> pool(
+            conf,
+            serialize_id,
+            [main_pid](const char *genome, size_t size) {
+                // evaluated in another process
+                if (getpid() == main_pid) _exit(2);
+                return static_cast<float>(deserialize_id(genome, size) * 2);
+            },
+            set_fitness);
+    REQUIRE(pool.size() == 3);
+
+    std::vector<std::unique_ptr<ChildIndividual> > individuals;
+    std::vector<ChildIndividual *> pointers;
+    for (int i = 0; i < 100; i++) {
+        individuals.emplace_back(std::make_unique<ChildIndividual>(i));
+        pointers.push_back(individuals.back().get());
+    }
+
+    // twice, to reuse the workers
+    for (int round = 0; round < 2; round++) {
+        for (auto &indiv : individuals) indiv->set_fitness(-1);
+        pool.evaluate(pointers.begin(), pointers.end());
+        for (auto &indiv : individuals) {
+            REQUIRE(indiv->fitness().value() == static_cast<float>(indiv->get_id() * 2));
+        }
+    }
+    REQUIRE(pool.crashed_workers() == 0);
+}
+
+TEST_CASE("Process pool retries individuals that crashed a worker" "[process_pool]")
+{
+    SharedCounter crashes;
+    speciation::ProcessPoolConf conf;
+    conf.workers = 2;
+    conf.max_retries = 2;
+
+    std::atomic<int> *counter = crashes.value;
+    speciation::ProcessPool<ChildIndividual, float> pool(
+            conf,
+            serialize_id,
+            [counter](const char *genome, size_t size) {
+                int id = deserialize_id(genome, size);
+                if (id == 7 && counter->fetch_add(1) < 2) kill(getpid(), SIGKILL);
+                return static_cast<float>(id);
+            },
+            set_fitness);
+
+    std::vector<std::unique_ptr<ChildIndividual> > individuals;
+    std::vector<ChildIndividual *> pointers;
+    for (int i = 0; i < 20; i++) {
+        individuals.emplace_back(std::make_unique<ChildIndividual>(i));
+        pointers.push_back(individuals.back().get());
+    }
+
+    pool.evaluate(pointers.begin(), pointers.end());
+    REQUIRE(pool.crashed_workers() == 2);
+    for (auto &indiv : individuals) {
+        REQUIRE(indiv->fitness().value() == static_cast<float>(indiv->get_id()));
+    }
+}
+
+TEST_CASE("Process pool gives up on individuals that always crash" "[process_pool]")
+{
+    speciation::ProcessPoolConf conf;
+    conf.workers = 2;
+    conf.max_retries = 1;
+
+    speciation::ProcessPool<ChildIndividual, float> pool(
+            conf,
+            serialize_id,
+            [](const char *genome, size_t size) {
+                int id = deserialize_id(genome, size);
+                if (id == 3) _exit(1);
+                return static_cast<float>(id);
+            },
+            set_fitness);
+
+    std::vector<std::unique_ptr<ChildIndividual> > individuals;
+    std::vector<ChildIndividual *> pointers;
+    for (int i = 0; i < 10; i++) {
+        individuals.emplace_back(std::make_unique<ChildIndividual>(i));
+        pointers.push_back(individuals.back().get());
+    }
+
+    REQUIRE_THROWS_AS(pool.evaluate(pointers.begin(), pointers.end()), std::runtime_error);
+
+    // the pool is still usable afterwards
+    pointers.erase(pointers.begin() + 3);
+    REQUIRE_NOTHROW(pool.evaluate(pointers.begin(), pointers.end()));
+    REQUIRE(individuals[9]->fitness().value() == 9.f);
+}
+
+TEST_CASE("Process pool rejects genomes bigger than the shared memory" "[process_pool]")
+{
+    speciation::ProcessPoolConf conf;
+    conf.workers = 1;
+    conf.shared_memory_size = 2;
+
+    speciation::ProcessPool<ChildIndividual, float> pool(
+            conf,
+            serialize_id,
+            [](const char *, size_t) { return 0.f; },
+            set_fitness);
+
+    ChildIndividual individual(1);
+    std::vector<ChildIndividual *> pointers = {&individual};
+    REQUIRE_THROWS_AS(pool.evaluate(pointers.begin(), pointers.end()), std::length_error);
+}
+
+#endif
@@ -0,0 +1,117 @@
+#include <set>
+#include <vector>
+#include <forward_list>
+#include "catch2/catch.hpp"
+#include "speciation/Random.h"
+
+using namespace speciation;
+
+TEST_CASE("Bounded random integers stay in range" "[random]")
+{
+    std::mt19937 gen32(0);
+    std::mt19937_64 gen64(0);
+    Xoshiro256PlusPlus xoshiro(0);
+
+    for (uint64_t range : {1ull, 2ull, 3ull, 7ull, 1000ull, 0xFFFFFFFFull, 0x100000001ull, 0xFFFFFFFFFFFFFFFFull}) {
+        for (int i = 0; i < 1000; i++) {
+            REQUIRE(bounded_rand(gen32, range) < range);
+            REQUIRE(bounded_rand(gen64, range) < range);
+            REQUIRE(bounded_rand(xoshiro, range) < range);
+        }
+    }
+}
+
+TEST_CASE("Bounded random integers are uniform" "[random]")
+{
+    Philox4x32 gen(42);
+    constexpr unsigned int range = 6;
+    constexpr unsigned int draws = 60000;
+    std::vector<unsigned int> counts(range, 0);
+    for (unsigned int i = 0; i < draws; i++) {
+        counts[bounded_rand(gen, range)]++;
+    }
+    for (unsigned int count : counts) {
+        REQUIRE(count / double(draws) == Approx(1. / range).margin(0.01));
+    }
+}
+
+TEST_CASE("Select randomly" "[random]")
+{
+    PCG64 gen(0);
+    std::vector<int> vec = {1, 2, 3};
+    std::forward_list<int> list = {1, 2, 3};
+    std::set<int> found_vec, found_list;
+    for (int i = 0; i < 100; i++) {
+        found_vec.insert(*select_randomly(vec.begin(), vec.end(), gen));
+        found_list.insert(*select_randomly(list.begin(), list.end(), gen));
+    }
+    REQUIRE(found_vec.size() == 3);
+    REQUIRE(found_list.size() == 3);
+}
+
+TEST_CASE("Engines are reproducible and seed dependent" "[random]")
+{
+    Xoshiro256PlusPlus xoshiro_a(1), xoshiro_b(1), xoshiro_c(2);
+    PCG64 pcg_a(1), pcg_b(1), pcg_c(1, 1);
+    for (int i = 0; i < 100; i++) {
+        REQUIRE(xoshiro_a() == xoshiro_b());
+        REQUIRE(pcg_a() == pcg_b());
+    }
+    REQUIRE(xoshiro_a() != xoshiro_c());
+    REQUIRE(pcg_a() != pcg_c());
+
+    Xoshiro256PlusPlus jumped(1);
+    jumped.jump();
+    REQUIRE(jumped != xoshiro_b);
+
+    // they satisfy UniformRandomBitGenerator
+    std::uniform_real_distribution<double> dis(0, 1);
+    double value = dis(pcg_a);
+    REQUIRE(value >= 0);
+    REQUIRE(value < 1);
+}
+
+TEST_CASE("Philox known answer" "[random]")
+{
+    // Random123 known answer test for philox4x32_10, counter = 0, key = 0
+    auto block = Philox4x32::block({0, 0, 0, 0}, {0, 0});
+    REQUIRE(block[0] == 0x6627e8d5u);
+    REQUIRE(block[1] == 0xe169c58du);
+    REQUIRE(block[2] == 0xbc57ac4cu);
+    REQUIRE(block[3] == 0x9b00dbd8u);
+
+    Philox4x32 gen(0);
+    REQUIRE(gen() == 0x6627e8d5u);
+    REQUIRE(gen() == 0xe169c58du);
+    REQUIRE(gen() == 0xbc57ac4cu);
+    REQUIRE(gen() == 0x9b00dbd8u);
+}
+
+TEST_CASE("Philox streams" "[random]")
+{
+    Philox4x32 root(1234);
+    Philox4x32 used_root(1234);
+    for (int i = 0; i < 17; i++) used_root();
+
+    // splitting does not depend on how much the parent was used
+    Philox4x32 a = root.split(7).split(3);
+    Philox4x32 b = used_root.split(7).split(3);
+    Philox4x32 c = root.split(3).split(7);
+    Philox4x32 d = root.split(8).split(3);
+    std::vector<uint32_t> out_a, out_b, out_c, out_d;
+    for (int i = 0; i < 16; i++) {
+        out_a.push_back(a());
+        out_b.push_back(b());
+        out_c.push_back(c());
+        out_d.push_back(d());
+    }
+    REQUIRE(out_a == out_b);
+    REQUIRE(out_a != out_c);
+    REQUIRE(out_a != out_d);
+
+    // skipping ahead is the same as drawing
+    Philox4x32 skip(99), draw(99);
+    skip.discard_blocks(5);
+    for (int i = 0; i < 20; i++) draw();
+    REQUIRE(skip() == draw());
+}
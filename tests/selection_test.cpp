@@ -264,3 +264,90 @@ TEST_CASE("Multiple selection with no duplicates should throw an exception when
                     }
             ), std::invalid_argument);
 }
+
+TEST_CASE("Alias table samples proportionally to the weights" "[selection]")
+{
+    std::mt19937 gen(0);
+    std::vector<double> weights = {1, 0, 2, 5};
+    speciation::AliasTable table(weights.begin(), weights.end());
+    REQUIRE(table.size() == weights.size());
+
+    std::vector<unsigned int> counts(weights.size(), 0);
+    constexpr unsigned int draws = 80000;
+    for (unsigned int i = 0; i < draws; i++) {
+        counts[table(gen)]++;
+    }
+
+    REQUIRE(counts[1] == 0);
+    REQUIRE(counts[0] / double(draws) == Approx(1. / 8.).margin(0.01));
+    REQUIRE(counts[2] / double(draws) == Approx(2. / 8.).margin(0.01));
+    REQUIRE(counts[3] / double(draws) == Approx(5. / 8.).margin(0.01));
+
+    std::vector<double> negative = {1, -1};
+    REQUIRE_THROWS_AS(speciation::AliasTable(negative.begin(), negative.end()), std::invalid_argument);
+    std::vector<double> empty;
+    REQUIRE_THROWS_AS(speciation::AliasTable(empty.begin(), empty.end()), std::invalid_argument);
+}
+
+TEST_CASE("Alias selection" "[selection]")
+{
+    typedef std::vector<std::unique_ptr<IndividualF> >::const_iterator CIter;
+    std::mt19937 gen(0);
+
+    std::vector<std::unique_ptr<IndividualF> > population;
+    population.emplace_back(std::make_unique<IndividualF>(1, 1));
+    population.emplace_back(std::make_unique<IndividualF>(2, 2));
+    population.emplace_back(std::make_unique<IndividualF>(3, 3));
+
+    speciation::AliasSelection<float, CIter, speciation::standard_fitness> selection(gen);
+
+    std::vector<unsigned int> counts(population.size(), 0);
+    constexpr unsigned int draws = 60000;
+    for (unsigned int i = 0; i < draws; i++) {
+        CIter candidate = selection(population.cbegin(), population.cend());
+        counts[(*candidate)->id - 1]++;
+    }
+    REQUIRE(counts[0] / double(draws) == Approx(1. / 6.).margin(0.01));
+    REQUIRE(counts[1] / double(draws) == Approx(2. / 6.).margin(0.01));
+    REQUIRE(counts[2] / double(draws) == Approx(3. / 6.).margin(0.01));
+
+    std::vector<std::unique_ptr<IndividualF> > empty;
+    REQUIRE_THROWS_AS(selection(empty.cbegin(), empty.cend()), std::invalid_argument);
+
+    // the population is refilled in place: same address, the new generation token rebuilds the table
+    population[0]->_fitness = 0;
+    population[1]->_fitness = 0;
+    selection.set_generation(1);
+    for (unsigned int i = 0; i < 100; i++) {
+        REQUIRE((*selection(population.cbegin(), population.cend()))->id == 3);
+    }
+}
+
+TEST_CASE("Stochastic universal sampling" "[selection]")
+{
+    typedef std::vector<std::unique_ptr<IndividualF> >::iterator Iter;
+    typedef std::vector<std::unique_ptr<IndividualF> >::const_iterator CIter;
+    std::mt19937 gen(0);
+
+    std::vector<std::unique_ptr<IndividualF> > population;
+    population.emplace_back(std::make_unique<IndividualF>(1, 1));
+    population.emplace_back(std::make_unique<IndividualF>(2, 2));
+    population.emplace_back(std::make_unique<IndividualF>(3, 3));
+
+    // With integer expected values, SUS selects exactly the expected amount
+    for (int run = 0; run < 20; run++) {
+        std::vector<Iter> selected = speciation::stochastic_universal_sampling<float, Iter, speciation::standard_fitness>(
+                population.begin(), population.end(), 6, gen);
+        REQUIRE(selected.size() == 6);
+        REQUIRE(std::count(selected.begin(), selected.end(), population.begin()) == 1);
+        REQUIRE(std::count(selected.begin(), selected.end(), population.begin() + 1) == 2);
+        REQUIRE(std::count(selected.begin(), selected.end(), population.begin() + 2) == 3);
+    }
+
+    speciation::SUSSelection<float, CIter, speciation::standard_fitness> selection(gen, 6);
+    std::vector<unsigned int> counts(population.size(), 0);
+    for (int i = 0; i < 6; i++) {
+        counts[(*selection(population.cbegin(), population.cend()))->id - 1]++;
+    }
+    REQUIRE(counts == std::vector<unsigned int>{1, 2, 3});
+}
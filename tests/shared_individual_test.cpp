@@ -0,0 +1,160 @@
+#include <speciation/SharedIndividual.h>
+#include <speciation/Genus.h>
+#include <speciation/Individual.h>
+#include <speciation/Selection.h>
+#include "catch2/catch.hpp"
+#include "test_individuals.h"
+
+#include <random>
+
+using speciation::SharedIndividual;
+
+namespace {
+
+/// Individual with a large genome, counting the deep copies
+class GenomeIndividual {
+    std::vector<int> genome;
+    std::optional<float> _fitness;
+
+public:
+    static int copies;
+
+    explicit GenomeIndividual(int value) : genome(1000, value) {}
+
+    [[nodiscard]] std::optional<float> fitness() const { return _fitness; }
+    void set_fitness(float fitness) { _fitness = fitness; }
+    [[nodiscard]] bool is_compatible(const GenomeIndividual &other) const { return group() == other.group(); }
+    [[nodiscard]] double distance(const GenomeIndividual &other) const { return std::abs(group() - other.group()); }
+    [[nodiscard]] GenomeIndividual clone() const
+    {
+        copies++;
+        return *this;
+    }
+
+    [[nodiscard]] int value() const { return genome[0]; }
+    [[nodiscard]] int group() const { return genome[0] / 100; }
+    void set_value(int value) { std::fill(genome.begin(), genome.end(), value); }
+};
+
+int GenomeIndividual::copies = 0;
+
+using Shared = SharedIndividual<GenomeIndividual>;
+
+}
+
+TEST_CASE("Shared individual copy on write" "[shared]")
+{
+    static_assert(speciation::is_individual_v<Shared, float>, "SharedIndividual is an individual");
+    static_assert(speciation::detail::has_distance<Shared>::value, "distance is forwarded");
+    static_assert(!speciation::detail::has_sketch<Shared>::value, "sketch is forwarded only if present");
+
+    GenomeIndividual::copies = 0;
+    Shared a(GenomeIndividual(7));
+    REQUIRE_FALSE(a.is_shared());
+
+    Shared b = a.clone();
+    REQUIRE(a.get() == b.get());
+    REQUIRE(a.use_count() == 2);
+    REQUIRE(GenomeIndividual::copies == 0);
+    REQUIRE(a.is_compatible(b));
+    REQUIRE(a.distance(b) == 0.);
+
+    // the first write copies, the next ones don't
+    b.get_mutable().set_value(250);
+    REQUIRE(GenomeIndividual::copies == 1);
+    REQUIRE(a.get() != b.get());
+    REQUIRE(a->value() == 7);
+    REQUIRE(b->value() == 250);
+    b.get_mutable().set_fitness(3.f);
+    REQUIRE(GenomeIndividual::copies == 1);
+    REQUIRE(b.fitness() == 3.f);
+    REQUIRE_FALSE(a.fitness().has_value());
+    REQUIRE_FALSE(a.is_compatible(b));
+}
+
+TEST_CASE("Shared individual selection without copies" "[shared]")
+{
+    using Iter = std::vector<std::unique_ptr<Shared> >::const_iterator;
+    GenomeIndividual::copies = 0;
+    std::mt19937 gen(0);
+
+    std::vector<std::unique_ptr<Shared> > source;
+    for (int i = 0; i < 5; i++) {
+        source.emplace_back(std::make_unique<Shared>(GenomeIndividual(i)));
+        source.back()->get_mutable().set_fitness(static_cast<float>(i));
+    }
+    std::vector<std::unique_ptr<Shared> > destination;
+    for (int i = 0; i < 3; i++) destination.emplace_back(std::make_unique<Shared>(GenomeIndividual(-1)));
+
+    speciation::multiple_selection_no_duplicates(
+            source.cbegin(), source.cend(), destination.begin(), destination.end(),
+            [&gen](Iter begin, Iter end) {
+                return speciation::tournament_selection<float, Iter, speciation::standard_fitness>(begin, end, gen, 2);
+            });
+    speciation::multiple_selection_with_duplicates(
+            source.cbegin(), source.cend(), destination.begin(), destination.end(),
+            [&gen](Iter begin, Iter end) {
+                return speciation::tournament_selection<float, Iter, speciation::standard_fitness>(begin, end, gen, 2);
+            });
+    REQUIRE(GenomeIndividual::copies == 0);
+    for (const std::unique_ptr<Shared> &selected : destination) {
+        REQUIRE(selected->is_shared());
+        REQUIRE(selected->fitness().has_value());
+    }
+}
+
+TEST_CASE("Genus with shared elites" "[shared]")
+{
+    speciation::Conf conf;
+    conf.total_population_size = 20;
+    conf.crossover = false;
+
+    std::vector<std::unique_ptr<Shared> > population;
+    for (int i = 0; i < 20; i++) {
+        population.emplace_back(std::make_unique<Shared>(GenomeIndividual((i % 2) * 100 + i)));
+    }
+    speciation::Genus<Shared, float> genus;
+    genus.speciate(population.begin(), population.end(), conf);
+    REQUIRE(genus.size() == 2);
+
+    auto evaluate = [](Shared *individual) {
+        const float fitness = static_cast<float>(individual->get()->value() % 100 + 1);
+        if (individual->fitness() != fitness)
+            individual->get_mutable().set_fitness(fitness);
+        return fitness;
+    };
+    // elitism: the best old individual of each species survives, shared with the previous generation
+    auto population_manager = [](std::vector<std::unique_ptr<Shared> > &&new_individuals,
+                                 const std::vector<const Shared *> &old_individuals,
+                                 unsigned int target_population) {
+        const Shared *elite = *std::max_element(old_individuals.begin(), old_individuals.end(),
+                [](const Shared *a, const Shared *b) { return a->fitness() < b->fitness(); });
+        new_individuals.resize(target_population - 1);
+        new_individuals.emplace_back(std::make_unique<Shared>(elite->clone()));
+        return std::move(new_individuals);
+    };
+
+    GenomeIndividual::copies = 0;
+    int mutations = 0;
+    for (int generation = 0; generation < 3; generation++) {
+        genus.ensure_evaluated_population(evaluate);
+        genus.update(conf);
+        speciation::GenusSeed seed = generate_from_first_individual(
+                genus, conf,
+                // the child shares the parent genome until it's mutated
+                [](const Shared &parent) { return std::make_unique<Shared>(parent.clone()); },
+                [&mutations](Shared &child) {
+                    if (child->value() % 3 == 0) {
+                        child.get_mutable().set_value(child->value() + 1);
+                        mutations++;
+                    }
+                });
+        seed.evaluate(evaluate);
+        genus = genus.next_generation(conf, std::move(seed), population_manager);
+        REQUIRE(genus.count_individuals() == conf.total_population_size);
+    }
+
+    // only the mutated children were copied
+    REQUIRE(mutations > 0);
+    REQUIRE(GenomeIndividual::copies == mutations);
+}
@@ -5,6 +5,7 @@
 #include "catch2/catch.hpp"
 #include "speciation/speciation.h"
 #include "speciation/Species.h"
+#include "speciation/Genus.h"
 #include "speciation/exceptions.h"
 #include "test_individuals.h"
 
@@ -188,3 +189,110 @@ TEST_CASE("Species iterator" "[species]")
     REQUIRE(species.adjusted_fitness(1).value() == Approx(44.40333f));
     REQUIRE(species.adjusted_fitness(2).value() == Approx(44.77));
 }
+
+namespace {
+/// Sketch of a SketchIndividual: its group
+struct GroupSketch {
+    int group;
+    [[nodiscard]] bool may_be_compatible(const GroupSketch &other) const
+    { return group == other.group; }
+};
+
+/// Individual with an "expensive" compatibility check, prefiltered with a sketch
+class SketchIndividual : public ChildIndividual {
+    GroupSketch _sketch;
+public:
+    static inline unsigned int exact_checks = 0;
+
+    explicit SketchIndividual(int id) : ChildIndividual(id, 1), _sketch{id / 10} {}
+    [[nodiscard]] bool is_compatible(const ChildIndividual &other) const override
+    {
+        exact_checks++;
+        return get_id() / 10 == other.get_id() / 10;
+    }
+    [[nodiscard]] const GroupSketch& sketch() const
+    { return _sketch; }
+};
+}
+
+TEST_CASE("Species compatibility prefiltered by sketch" "[species]")
+{
+    SketchIndividual::exact_checks = 0;
+    Species<SketchIndividual, float> species(std::make_unique<SketchIndividual>(3), 1);
+
+    REQUIRE_FALSE(species.is_compatible(SketchIndividual(42), 1.0));
+    REQUIRE(SketchIndividual::exact_checks == 0);
+    REQUIRE(species.is_compatible(SketchIndividual(7), 1.0));
+    REQUIRE(SketchIndividual::exact_checks == 1);
+
+    // the sketch follows the representative
+    std::vector<std::unique_ptr<SketchIndividual>> new_individuals;
+    new_individuals.emplace_back(std::make_unique<SketchIndividual>(45));
+    species.set_individuals(std::move(new_individuals));
+    REQUIRE(species.is_compatible(SketchIndividual(42), 1.0));
+    REQUIRE_FALSE(species.is_compatible(SketchIndividual(7), 1.0));
+    REQUIRE(SketchIndividual::exact_checks == 2);
+
+    // the check without threshold is prefiltered too
+    REQUIRE_FALSE(species.is_compatible(SketchIndividual(7)));
+    REQUIRE(SketchIndividual::exact_checks == 2);
+
+    // representative removed, then a new one inserted (possibly at the same address)
+    species.remove(0);
+    species.insert(std::make_unique<SketchIndividual>(8));
+    REQUIRE(species.is_compatible(SketchIndividual(7)));
+    REQUIRE_FALSE(species.is_compatible(SketchIndividual(42)));
+    REQUIRE(SketchIndividual::exact_checks == 3);
+
+    // representative replaced in place
+    species.individual(0) = SketchIndividual(91);
+    species.update_representative_sketch();
+    REQUIRE(species.is_compatible(SketchIndividual(95)));
+    REQUIRE_FALSE(species.is_compatible(SketchIndividual(7)));
+    REQUIRE(SketchIndividual::exact_checks == 4);
+
+    // speciation: the exact check runs only once per non-founder individual
+    SketchIndividual::exact_checks = 0;
+    Genus<SketchIndividual, float> genus;
+    std::vector<std::unique_ptr<SketchIndividual>> population;
+    for (int i = 0; i < 100; i++) {
+        population.emplace_back(std::make_unique<SketchIndividual>(i));
+    }
+    genus.speciate(population.begin(), population.end());
+    REQUIRE(genus.size() == 10);
+    REQUIRE(SketchIndividual::exact_checks == 90);
+}
+
+namespace {
+/// Individual with the static (CRTP) prototype: no virtual functions
+class StaticChildIndividual : public StaticIndividualPrototype<float, StaticChildIndividual> {
+    int id;
+    std::optional<float> _fitness;
+public:
+    StaticChildIndividual(int id, float fitness) : id(id), _fitness(fitness) {}
+    [[nodiscard]] std::optional<float> fitness() const { return _fitness; }
+    [[nodiscard]] bool is_compatible(const StaticChildIndividual &other) const { return id % 2 == other.id % 2; }
+    [[nodiscard]] StaticChildIndividual clone() const { return *this; }
+};
+
+static_assert(!std::is_polymorphic<StaticChildIndividual>::value);
+static_assert(is_individual_v<StaticChildIndividual, float>);
+static_assert(is_individual_v<ChildIndividual, float>);
+static_assert(!is_individual_v<Individual42, float>);
+#ifdef SPECIATION_HAS_CONCEPTS
+static_assert(IndividualConcept<StaticChildIndividual, float>);
+static_assert(!IndividualConcept<StaticChildIndividual, double>);
+#endif
+}
+
+TEST_CASE("Static individual prototype" "[species]")
+{
+    Genus<StaticChildIndividual, float> genus;
+    std::vector<std::unique_ptr<StaticChildIndividual>> population;
+    for (int i = 0; i < 10; i++) {
+        population.emplace_back(std::make_unique<StaticChildIndividual>(i, static_cast<float>(i)));
+    }
+    genus.speciate(population.begin(), population.end());
+    REQUIRE(genus.size() == 2);
+    REQUIRE(genus.best_individuals(1).front()->fitness().value() == 9);
+}
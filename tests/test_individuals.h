@@ -5,7 +5,10 @@
 #ifndef SPECIATION_TEST_INDIVIDUALS_H
 #define SPECIATION_TEST_INDIVIDUALS_H
 
+#include <cassert>
 #include <optional>
+#include <utility>
+#include <speciation/Conf.h>
 #include <speciation/Individual.h>
 
 struct Individual42 {
@@ -115,4 +118,24 @@ public:
 
 };
 
+/**
+ * Generates the offspring of a genus without crossover, every child from the first individual of its species.
+ * For the tests of individuals and evaluators, which don't depend on the selection.
+ * @param reproduce creates a child from its parent
+ * @param mutate mutates a child
+ */
+template<typename Genus, typename Reproduce, typename Mutate>
+auto generate_from_first_individual(const Genus &genus, const speciation::Conf &conf,
+                                    const Reproduce &reproduce, const Mutate &mutate)
+{
+    assert(!conf.crossover);
+    return genus.generate_new_individuals(
+            conf,
+            [](auto begin, auto) { return begin; },
+            [](auto begin, auto) { return std::make_pair(begin, begin + 1); },
+            reproduce,
+            [&reproduce](const auto &parent, const auto &) { return reproduce(parent); },
+            mutate);
+}
+
 #endif //SPECIATION_TEST_INDIVIDUALS_H